@@ -0,0 +1,823 @@
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include "../common/compact.h"
+#include "../common/messages.h"
+#include "../common/allocation_counter.h"
+#include "../common/explosion_pool.h"
+#include "../server/client_queue.h"
+#include "../server/game_manager.h"
+
+namespace po = boost::program_options;
+
+// Encode and decode throughput of all messages, measured on in-memory buffers (no sockets).
+
+constexpr player_id_t BENCH_PLAYERS = 64;
+constexpr player_id_t LARGE_ROOM_PLAYERS = 255;
+constexpr coordinate_t BENCH_SIZE = 100;
+constexpr size_t BENCH_BLOCKS = 1000;
+constexpr size_t BENCH_BOMBS = 100;
+constexpr bomb_id_t BENCH_EXPLODED_BOMBS = 8;
+constexpr coordinate_t LARGE_BENCH_SIZE = 1000;
+constexpr size_t LARGE_BENCH_BLOCKS = 40000;
+constexpr bomb_timer_t BENCH_BOMB_TIMER = 10;
+// Turns run after bombs placed in the first turns have exploded, before turns are measured.
+constexpr size_t WARM_UP_TURNS = 64;
+// Turns of a game in a steady state checked not to allocate memory.
+constexpr size_t CHECKED_TURNS = 4096;
+
+struct BenchOptions {
+    std::chrono::milliseconds min_time{200}; // Minimal duration of every measurement.
+    std::string filter; // Only measurements with names containing it are run.
+};
+
+// Runs 'operation' (processing a message of 'message_length' bytes) repeatedly and prints its
+// throughput and allocations per operation.
+void measure(const BenchOptions &options, const std::string &name, size_t message_length,
+             const std::function<void()> &operation) {
+    if (name.find(options.filter) == std::string::npos) {
+        return;
+    }
+    operation(); // Warm up.
+    uint64_t operations = 0;
+    uint64_t allocations = get_allocations();
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed{};
+    do {
+        for (int i = 0; i < 64; i++) {
+            operation();
+        }
+        operations += 64;
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed < options.min_time);
+    allocations = get_allocations() - allocations;
+    double seconds = elapsed.count();
+    printf("%-48s %10zu B %14.0f msg/s %10.1f MB/s %8.2f allocs/op\n", name.c_str(),
+           message_length, (double) operations / seconds,
+           (double) (operations * message_length) / seconds / 1e6,
+           (double) allocations / (double) operations);
+}
+
+// Prepares a state of a game in progress: players with positions and scores, blocks and bombs.
+void prepare_game_state(GameState &game_state, coordinate_t size, size_t blocks, size_t bombs,
+                        player_id_t players = BENCH_PLAYERS) {
+    std::minstd_rand random(1);
+    game_state.type = GameStateType::Game;
+    game_state.server_name = "Benchmark server";
+    game_state.players_count = players;
+    game_state.size_x = size;
+    game_state.size_y = size;
+    game_state.resize_board();
+    game_state.game_length = 1000;
+    game_state.explosion_radius = 5;
+    game_state.bomb_timer = BENCH_BOMB_TIMER;
+    game_state.turn = 500;
+    auto random_position = [&] {
+        return Position((coordinate_t) (random() % size), (coordinate_t) (random() % size));
+    };
+    for (player_id_t player_id = 0; player_id < players; player_id++) {
+        game_state.players[player_id] = Player("Player " + std::to_string(player_id),
+                                               "[2001:db8::1]:" + std::to_string(10000 + player_id));
+        game_state.player_positions.move(player_id, random_position());
+        game_state.scores[player_id] = (score_t) (random() % 20);
+    }
+    while (game_state.blocks.size() < blocks) {
+        game_state.blocks.insert(random_position());
+    }
+    for (bomb_id_t bomb_id = 0; bomb_id < bombs; bomb_id++) {
+        auto timer = (explosion_turn_t) (random() % 10 + 1);
+        game_state.bombs.insert(bomb_id, Bomb(random_position(), game_state.turn + timer));
+    }
+    for (size_t i = 0; i < blocks / 10; i++) {
+        game_state.explosions.insert(random_position());
+    }
+}
+
+// Prepares events of a busy turn: every player moves or places a bomb or a block, and some
+// bombs explode destroying robots and blocks.
+void prepare_turn_events(TurnEvents &events, GameState &game_state) {
+    bomb_id_t next_bomb_id = (bomb_id_t) game_state.bombs.size();
+    for (bomb_id_t bomb_id = 0; bomb_id < BENCH_EXPLODED_BOMBS; bomb_id++) {
+        events.add_bomb_exploded(bomb_id, game_state);
+        game_state.explosions.clear();
+    }
+    for (auto const & [player_id, position]: game_state.player_positions) {
+        switch (player_id % 8) {
+            case 0:
+                events.add_bomb_placed(next_bomb_id++, position);
+                break;
+            case 1:
+                events.add_block_placed(position);
+                break;
+            default:
+                events.add_player_moved(
+                        player_id, Position(position.get_x(), (coordinate_t) (position.get_y() + 1)));
+                break;
+        }
+    }
+}
+
+// Prepares the state of the game kept by a client decoding messages about 'game_state': the
+// parameters of the game and its bombs (which Turn messages explode).
+void prepare_decoded_game_state(GameState &decoded_game_state, const GameState &game_state) {
+    decoded_game_state.size_x = game_state.size_x;
+    decoded_game_state.size_y = game_state.size_y;
+    decoded_game_state.resize_board();
+    decoded_game_state.explosion_radius = game_state.explosion_radius;
+    decoded_game_state.bomb_timer = game_state.bomb_timer;
+    decoded_game_state.bombs.resize(game_state.bomb_timer);
+    for (auto const & [bomb_id, bomb]: game_state.bombs) {
+        decoded_game_state.bombs.insert(bomb_id, bomb);
+    }
+}
+
+// Places again the bombs exploded by decoding a Turn message, so that every decoding explodes
+// them.
+void restore_exploded_bombs(GameState &decoded_game_state, const GameState &game_state) {
+    for (bomb_id_t bomb_id = 0; bomb_id < BENCH_EXPLODED_BOMBS; bomb_id++) {
+        decoded_game_state.bombs.insert(bomb_id, game_state.bombs[bomb_id]);
+    }
+}
+
+// Encodes a server message and returns its bytes.
+std::vector<char> encode(const ServerMessage &server_message, GameState &game_state) {
+    BufferMemory buffer;
+    server_message.insert_to_buffer(buffer, game_state);
+    return {buffer.get_data(), buffer.get_data() + buffer.get_message_length()};
+}
+
+void bench_server_messages(const BenchOptions &options) {
+    GameState game_state;
+    prepare_game_state(game_state, BENCH_SIZE, BENCH_BLOCKS, BENCH_BOMBS);
+    TurnEvents turn_events;
+    prepare_turn_events(turn_events, game_state);
+    std::vector<std::pair<std::string, ServerMessage>> server_messages;
+    server_messages.emplace_back("Hello", ServerMessage(ServerMessageType::Hello));
+    server_messages.emplace_back("AcceptedPlayer", ServerMessage(
+            ServerMessageType::AcceptedPlayer, 7, game_state.players[7]));
+    server_messages.emplace_back("GameStarted", ServerMessage(ServerMessageType::GameStarted,
+                                                              game_state));
+    server_messages.emplace_back("Turn", ServerMessage(ServerMessageType::Turn, game_state.turn,
+                                                       turn_events));
+    server_messages.emplace_back("GameEnded", ServerMessage(ServerMessageType::GameEnded,
+                                                            game_state));
+
+    BufferMemory buffer;
+    for (auto const & [name, server_message]: server_messages) {
+        std::vector<char> bytes = encode(server_message, game_state);
+        measure(options, "ServerMessage " + name + " encode", bytes.size(), [&] {
+            buffer.clear();
+            server_message.insert_to_buffer(buffer, game_state);
+        });
+        measure(options, "ServerMessage " + name + " encode once", bytes.size(), [&] {
+            EncodedMessage encoded_message(server_message, game_state);
+        });
+        // Decoding updates the state, so it is done on a copy of the game parameters and bombs.
+        GameState decoded_game_state;
+        prepare_decoded_game_state(decoded_game_state, game_state);
+        measure(options, "ServerMessage " + name + " decode", bytes.size(), [&] {
+            buffer.load(bytes.data(), bytes.size());
+            ServerMessage decoded(buffer, decoded_game_state);
+            restore_exploded_bombs(decoded_game_state, game_state);
+        });
+    }
+
+    // Turn message in the compact encoding (made from the standard one, like the server does).
+    std::vector<char> turn_bytes = encode(server_messages[3].second, game_state);
+    TurnView turn_view(turn_bytes.data() + MESSAGE_ID_SIZE, turn_bytes.size() - MESSAGE_ID_SIZE);
+    buffer.clear();
+    CompactTurn::insert_to_buffer(buffer, turn_view);
+    std::vector<char> bytes(buffer.get_data(), buffer.get_data() + buffer.get_message_length());
+    measure(options, "ServerMessage CompactTurn encode", bytes.size(), [&] {
+        buffer.clear();
+        CompactTurn::insert_to_buffer(buffer, turn_view);
+    });
+    GameState decoded_game_state;
+    prepare_decoded_game_state(decoded_game_state, game_state);
+    measure(options, "ServerMessage CompactTurn decode", bytes.size(), [&] {
+        buffer.load(bytes.data(), bytes.size());
+        ServerMessage decoded(buffer, decoded_game_state);
+        restore_exploded_bombs(decoded_game_state, game_state);
+    });
+}
+
+void bench_client_messages(const BenchOptions &options) {
+    std::vector<std::pair<std::string, std::vector<char>>> client_messages = {
+            {"Join", {0, 8, 'B', 'e', 'n', 'c', 'h', 'm', 'a', 'r'}},
+            {"PlaceBomb", {1}},
+            {"PlaceBlock", {2}},
+            {"Move", {3, 2}},
+    };
+    BufferMemory buffer;
+    for (auto const & [name, bytes]: client_messages) {
+        buffer.load(bytes.data(), bytes.size());
+        ClientMessage client_message(buffer);
+        measure(options, "ClientMessage " + name + " encode", bytes.size(), [&] {
+            buffer.clear();
+            client_message.insert_to_buffer(buffer);
+        });
+        measure(options, "ClientMessage " + name + " decode", bytes.size(), [&] {
+            buffer.load(bytes.data(), bytes.size());
+            ClientMessage decoded(buffer);
+        });
+    }
+}
+
+void bench_input_messages(const BenchOptions &options) {
+    std::vector<std::pair<std::string, std::vector<char>>> input_messages = {
+            {"PlaceBomb", {0}},
+            {"PlaceBlock", {1}},
+            {"Move", {2, 1}},
+    };
+    BufferMemory buffer;
+    for (auto const & [name, bytes]: input_messages) {
+        measure(options, "InputMessage " + name + " decode", bytes.size(), [&] {
+            buffer.load(bytes.data(), bytes.size());
+            InputMessage decoded(buffer);
+        });
+    }
+}
+
+void bench_draw_messages(const BenchOptions &options) {
+    BufferMemory buffer;
+    auto bench_draw_message = [&](const std::string &name, ServerMessageType type,
+                                  GameState &game_state) {
+        DrawMessage draw_message(ServerMessage(type), game_state);
+        buffer.clear();
+        draw_message.insert_to_buffer(buffer, game_state);
+        measure(options, "DrawMessage " + name + " encode", buffer.get_message_length(), [&] {
+            buffer.clear();
+            draw_message.insert_to_buffer(buffer, game_state);
+        });
+    };
+
+    GameState game_state;
+    prepare_game_state(game_state, BENCH_SIZE, BENCH_BLOCKS, BENCH_BOMBS);
+    bench_draw_message("Lobby", ServerMessageType::Hello, game_state);
+    bench_draw_message("Game", ServerMessageType::Turn, game_state);
+
+    GameState large_game_state;
+    prepare_game_state(large_game_state, LARGE_BENCH_SIZE, LARGE_BENCH_BLOCKS, BENCH_BOMBS);
+    bench_draw_message("Game (large board)", ServerMessageType::Turn, large_game_state);
+}
+
+// Calculation of explosions of all bombs (the kernel of a turn with many explosions), for every
+// engine, board size, explosion radius and number of bombs.
+void bench_explosions(const BenchOptions &options) {
+    std::vector<std::pair<std::string, ExplosionEngine>> engines = {
+            {"reference", ExplosionEngine::Reference},
+            {"bitboard", ExplosionEngine::Bitboard},
+            {"extents", ExplosionEngine::Extents},
+    };
+    for (coordinate_t size: {BENCH_SIZE, LARGE_BENCH_SIZE}) {
+        for (explosion_radius_t radius: std::initializer_list<explosion_radius_t>{2, 10, 100}) {
+            for (size_t bombs: {16, 256}) {
+                for (auto const & [engine_name, engine]: engines) {
+                    GameState game_state;
+                    game_state.explosion_engine = engine;
+                    prepare_game_state(game_state, size, (size_t) size * size / 10, bombs);
+                    game_state.explosion_radius = radius;
+                    std::string name = "Explosions " + engine_name + " size=" +
+                                       std::to_string(size) + " r=" + std::to_string(radius) +
+                                       " bombs=" + std::to_string(bombs);
+                    measure(options, name, 0, [&] {
+                        for (auto const & [bomb_id, bomb]: game_state.bombs) {
+                            BombExploded::calculate_explosion(bomb_id, game_state);
+                            game_state.explosions.clear();
+                        }
+                    });
+                }
+            }
+        }
+    }
+
+    // Cost of keeping data of the engine up to date: placing a block and destroying it.
+    for (coordinate_t size: {BENCH_SIZE, LARGE_BENCH_SIZE}) {
+        for (auto const & [engine_name, engine]: engines) {
+            GameState game_state;
+            game_state.explosion_engine = engine;
+            prepare_game_state(game_state, size, (size_t) size * size / 10, 0);
+            std::minstd_rand random(2);
+            std::vector<Position> new_blocks;
+            while (new_blocks.size() < 1024) {
+                Position position((coordinate_t) (random() % size), (coordinate_t) (random() % size));
+                if (!game_state.blocks.contains(position)) {
+                    new_blocks.push_back(position);
+                }
+            }
+            size_t next_block = 0;
+            measure(options, "Block place and destroy " + engine_name + " size=" +
+                             std::to_string(size), 0, [&] {
+                Position position = new_blocks[next_block++ % new_blocks.size()];
+                game_state.blocks.insert(position);
+                game_state.blocks.erase(position);
+            });
+        }
+    }
+}
+
+// Returns all messages a player can send during a game: PlaceBomb, PlaceBlock and Move.
+std::vector<ClientMessage> get_game_messages() {
+    std::vector<ClientMessage> client_messages;
+    BufferMemory buffer;
+    for (std::vector<char> bytes: std::initializer_list<std::vector<char>>{
+            {1}, {2}, {3, 0}, {3, 1}, {3, 2}, {3, 3}}) {
+        buffer.load(bytes.data(), bytes.size());
+        client_messages.emplace_back(buffer);
+    }
+    return client_messages;
+}
+
+// Game run by the server on a prepared board, every player sending a random message in every
+// turn: bombs explode, robots move and bombs and blocks are placed, and the Turn message is
+// encoded.
+class BenchGame {
+private:
+    std::vector<ClientMessage> client_messages = get_game_messages();
+    GameState game_state;
+    std::map<client_id_t, player_id_t> client_to_player_id;
+    BlockingMessageQueue pending_messages;
+    std::unique_ptr<GameManager> game_manager;
+    std::minstd_rand random{3};
+    turn_t turn = TURN_ZERO;
+
+public:
+    BenchGame(player_id_t players, size_t blocks, bomb_timer_t bomb_timer,
+              size_t action_threads = 1) {
+        prepare_game_state(game_state, BENCH_SIZE, blocks, 0, players);
+        game_state.bomb_timer = bomb_timer;
+        game_state.bombs.resize(bomb_timer);
+        game_manager = std::make_unique<GameManager>(game_state, client_to_player_id,
+                                                     pending_messages, 1, action_threads);
+        game_manager->initialize_game_state();
+        pending_messages.pop();
+    }
+
+    void run_turn() {
+        TurnMessages turn_messages;
+        for (player_id_t player_id = 0; player_id < game_state.players_count; player_id++) {
+            turn_messages[player_id] =
+                    PlayerInput(client_messages[random() % client_messages.size()]);
+        }
+        game_manager->run_turn(++turn, turn_messages);
+        pending_messages.pop();
+    }
+
+    // Runs turns until bombs placed in the first turns have exploded and memory reused by turns
+    // (the arena of events, buckets of bombs and blocks of encoded messages) has grown to the
+    // size of a busy turn, after which a turn doesn't allocate memory.
+    void warm_up() {
+        for (size_t i = 0; i < game_state.bomb_timer + WARM_UP_TURNS; i++) {
+            run_turn();
+        }
+    }
+
+    [[nodiscard]] size_t get_bombs() const {
+        return game_state.bombs.size();
+    }
+};
+
+// Turns of a game in a steady state. With a long bomb timer there are thousands of bombs
+// waiting to explode, which a turn doesn't visit.
+void bench_turns(const BenchOptions &options) {
+    for (bomb_timer_t bomb_timer: std::initializer_list<bomb_timer_t>{5, 1000}) {
+        BenchGame game(BENCH_PLAYERS, 0, bomb_timer);
+        game.warm_up();
+        measure(options, "GameManager run_turn bomb_timer=" + std::to_string(bomb_timer) +
+                         " bombs=" + std::to_string(game.get_bombs()), 0, [&] {
+            game.run_turn();
+        });
+    }
+}
+
+// Turns of a game in a room of 255 players, with actions of players evaluated by one thread and
+// by many threads.
+void bench_player_actions(const BenchOptions &options) {
+    for (size_t threads: {1, 2, 4}) {
+        BenchGame game(LARGE_ROOM_PLAYERS, BENCH_BLOCKS, BENCH_BOMB_TIMER, threads);
+        game.warm_up();
+        measure(options, "GameManager run_turn players=" + std::to_string(LARGE_ROOM_PLAYERS) +
+                         " action_threads=" + std::to_string(threads), 0, [&] {
+            game.run_turn();
+        });
+    }
+}
+
+// Explosions of all bombs of a turn with hundreds of bombs exploding at once, calculated one by
+// one and by ExplosionPool.
+void bench_parallel_explosions(const BenchOptions &options) {
+    for (size_t bombs: {256, 1024}) {
+        GameState game_state;
+        prepare_game_state(game_state, LARGE_BENCH_SIZE, LARGE_BENCH_BLOCKS, bombs);
+        game_state.explosion_radius = 100;
+        std::vector<bomb_id_t> bomb_ids;
+        for (auto const & [bomb_id, bomb]: game_state.bombs) {
+            bomb_ids.push_back(bomb_id);
+        }
+        TurnEvents events;
+        measure(options, "Turn explosions serial bombs=" + std::to_string(bombs), 0, [&] {
+            events.clear();
+            for (bomb_id_t bomb_id: bomb_ids) {
+                events.add_bomb_exploded(bomb_id, game_state);
+                game_state.explosions.clear();
+            }
+        });
+        for (size_t threads: {2, 4}) {
+            ThreadPool thread_pool(threads);
+            ExplosionPool explosion_pool(thread_pool);
+            measure(options, "Turn explosions threads=" + std::to_string(threads) + " bombs=" +
+                             std::to_string(bombs), 0, [&] {
+                events.clear();
+                explosion_pool.add_bombs_exploded(bomb_ids, game_state, events);
+            });
+        }
+    }
+}
+
+// Fills 'game_state' with a random board (the same one for the same seed).
+void prepare_random_board(GameState &game_state, uint32_t seed) {
+    std::minstd_rand random(seed);
+    // Sizes not being multiples of 64 and boards of one row or column are most interesting.
+    game_state.size_x = (coordinate_t) (random() % 4 == 0 ? random() % 2000 + 1 : random() % 150 + 1);
+    game_state.size_y = (coordinate_t) (random() % 4 == 0 ? random() % 2000 + 1 : random() % 150 + 1);
+    if (random() % 8 == 0) {
+        game_state.size_y = 1;
+    }
+    game_state.explosion_radius = (explosion_radius_t) (random() % 8 == 0 ? random() % 3000
+                                                                          : random() % 20);
+    game_state.bomb_timer = 1;
+    game_state.resize_board();
+    auto random_position = [&] {
+        return Position((coordinate_t) (random() % game_state.size_x),
+                        (coordinate_t) (random() % game_state.size_y));
+    };
+    size_t fields = (size_t) game_state.size_x * game_state.size_y;
+    size_t blocks = fields * (random() % 100) / 100;
+    for (size_t i = 0; i < std::min(blocks, (size_t) 10000); i++) {
+        game_state.blocks.insert(random_position());
+    }
+    for (player_id_t player_id = 0; player_id < BENCH_PLAYERS; player_id++) {
+        game_state.player_positions.move(player_id, random_position());
+    }
+    for (bomb_id_t bomb_id = 0; bomb_id < 32; bomb_id++) {
+        game_state.bombs.insert(bomb_id, Bomb(random_position(), game_state.turn + 1));
+    }
+}
+
+// Checks that all explosion engines give the same results on random boards, on which blocks
+// are destroyed and placed between explosions. Returns false if they don't.
+bool check_explosion_engines(uint64_t boards) {
+    const std::vector<ExplosionEngine> engines = {
+            ExplosionEngine::Reference, ExplosionEngine::Bitboard, ExplosionEngine::Extents};
+    uint64_t explosions = 0;
+    for (uint32_t seed = 1; seed <= boards; seed++) {
+        std::vector<std::unique_ptr<GameState>> game_states;
+        for (ExplosionEngine engine: engines) {
+            game_states.push_back(std::make_unique<GameState>());
+            game_states.back()->explosion_engine = engine;
+            prepare_random_board(*game_states.back(), seed);
+        }
+        GameState &reference_game_state = *game_states[0];
+        std::minstd_rand random(seed);
+
+        for (auto const & [bomb_id, bomb]: reference_game_state.bombs) {
+            std::vector<TurnEvents> bombs_exploded(game_states.size());
+            for (size_t engine = 0; engine < engines.size(); engine++) {
+                bombs_exploded[engine].add_bomb_exploded(bomb_id, *game_states[engine]);
+            }
+            for (size_t engine = 1; engine < engines.size(); engine++) {
+                GameState &game_state = *game_states[engine];
+                bool same_explosions = std::equal(
+                        reference_game_state.explosions.begin(),
+                        reference_game_state.explosions.end(),
+                        game_state.explosions.begin(), game_state.explosions.end());
+                if (!same_explosions ||
+                    !std::ranges::equal(bombs_exploded[0].get_robots_destroyed(),
+                                        bombs_exploded[engine].get_robots_destroyed()) ||
+                    !std::ranges::equal(bombs_exploded[0].get_blocks_destroyed(),
+                                        bombs_exploded[engine].get_blocks_destroyed())) {
+                    std::cerr << "Explosion engine " << engine << " differs from the reference on "
+                              << "board " << seed << " (bomb " << bomb_id << ")\n";
+                    return false;
+                }
+            }
+            // Destroy blocks and place some new ones.
+            Position new_block((coordinate_t) (random() % reference_game_state.size_x),
+                               (coordinate_t) (random() % reference_game_state.size_y));
+            for (auto const & game_state: game_states) {
+                game_state->explosions.clear();
+                for (Position block: bombs_exploded[0].get_blocks_destroyed()) {
+                    game_state->blocks.erase(block);
+                }
+                game_state->blocks.insert(new_block);
+            }
+            explosions++;
+        }
+    }
+    std::cout << explosions << " explosions on " << boards
+              << " boards calculated the same way by all engines\n";
+    return true;
+}
+
+// Checks that Turn messages with explosions calculated by ExplosionPool are the same as with
+// explosions calculated one by one, on random boards. Returns false if they aren't.
+bool check_explosion_pool(uint64_t boards) {
+    ThreadPool thread_pool(4);
+    ExplosionPool explosion_pool(thread_pool);
+    TurnEvents serial_events;
+    TurnEvents parallel_events;
+    for (uint32_t seed = 1; seed <= boards; seed++) {
+        GameState game_state;
+        prepare_random_board(game_state, seed);
+        std::vector<bomb_id_t> bomb_ids;
+        for (auto const & [bomb_id, bomb]: game_state.bombs) {
+            bomb_ids.push_back(bomb_id);
+        }
+        serial_events.clear();
+        for (bomb_id_t bomb_id: bomb_ids) {
+            serial_events.add_bomb_exploded(bomb_id, game_state);
+            game_state.explosions.clear();
+        }
+        parallel_events.clear();
+        explosion_pool.add_bombs_exploded(bomb_ids, game_state, parallel_events);
+        if (encode(ServerMessage(ServerMessageType::Turn, 1, serial_events), game_state) !=
+            encode(ServerMessage(ServerMessageType::Turn, 1, parallel_events), game_state)) {
+            std::cerr << "Turn with explosions calculated in parallel differs on board " << seed
+                      << "\n";
+            return false;
+        }
+    }
+    std::cout << "Turns on " << boards << " boards the same with explosions calculated in "
+              << "parallel\n";
+    return true;
+}
+
+// Checks that games in rooms of 255 players on small crowded boards (where players often place
+// blocks on the same fields and move onto them) give the same Turn messages with actions of
+// players evaluated by one thread and by many threads. Returns false if they don't.
+bool check_player_actions(uint64_t boards) {
+    std::vector<ClientMessage> client_messages = get_game_messages();
+    for (uint32_t seed = 1; seed <= boards; seed++) {
+        std::minstd_rand random(seed);
+        auto size = (coordinate_t) (random() % 16 + 1);
+        auto bomb_timer = (bomb_timer_t) (random() % 4 + 1);
+        auto explosion_radius = (explosion_radius_t) (random() % 4);
+        std::vector<std::unique_ptr<GameState>> game_states;
+        std::vector<std::unique_ptr<BlockingMessageQueue>> pending_messages;
+        std::vector<std::unique_ptr<GameManager>> game_managers;
+        std::map<client_id_t, player_id_t> client_to_player_id;
+        for (size_t threads: {1, 4}) {
+            game_states.push_back(std::make_unique<GameState>());
+            prepare_game_state(*game_states.back(), size, 0, 0, LARGE_ROOM_PLAYERS);
+            game_states.back()->seed = seed;
+            game_states.back()->initial_blocks = (initial_blocks_t) (size * size / 4);
+            game_states.back()->bomb_timer = bomb_timer;
+            game_states.back()->explosion_radius = explosion_radius;
+            game_states.back()->resize_board();
+            pending_messages.push_back(std::make_unique<BlockingMessageQueue>());
+            game_managers.push_back(std::make_unique<GameManager>(
+                    *game_states.back(), client_to_player_id, *pending_messages.back(), 1,
+                    threads));
+        }
+        for (turn_t turn = TURN_ZERO; turn < 20; turn++) {
+            TurnMessages turn_messages;
+            for (player_id_t player_id = 0; player_id < LARGE_ROOM_PLAYERS; player_id++) {
+                if (random() % 8 != 0) {
+                    turn_messages[player_id] =
+                            PlayerInput(client_messages[random() % client_messages.size()]);
+                }
+            }
+            for (auto const & game_manager: game_managers) {
+                if (turn == TURN_ZERO) {
+                    game_manager->initialize_game_state();
+                } else {
+                    game_manager->run_turn(turn, turn_messages);
+                }
+            }
+            auto serial_turn = pending_messages[0]->pop();
+            auto parallel_turn = pending_messages[1]->pop();
+            if (!std::equal(serial_turn->get_data(),
+                            serial_turn->get_data() + serial_turn->get_length(),
+                            parallel_turn->get_data(),
+                            parallel_turn->get_data() + parallel_turn->get_length())) {
+                std::cerr << "Turn " << turn << " with actions of players evaluated in parallel "
+                          << "differs on board " << seed << "\n";
+                return false;
+            }
+        }
+    }
+    std::cout << "Games on " << boards << " boards the same with actions of players evaluated "
+              << "in parallel\n";
+    return true;
+}
+
+// Decodes a message taken by a client into 'client_game_state', and returns the Draw message
+// sent then to its GUI (empty if there is none).
+std::vector<char> decode_message(const EncodedMessage &message, bool compact,
+                                 GameState &client_game_state) {
+    BufferMemory buffer;
+    buffer.load(message.get_data(compact), message.get_length(compact));
+    ServerMessage server_message(buffer, client_game_state);
+    if (!server_message.should_send_message_to_gui()) {
+        return {};
+    }
+    DrawMessage draw_message(server_message, client_game_state);
+    buffer.clear();
+    draw_message.insert_to_buffer(buffer, client_game_state);
+    return {buffer.get_data(), buffer.get_data() + buffer.get_message_length()};
+}
+
+// Checks that a client over the limit of queued messages, whose Turn messages are coalesced,
+// draws the same game as a client taking every message, after every Turn message it takes and
+// up to the end of the game (in both encodings). The client falls behind by a few turns at a
+// time of games on small crowded boards, with mostly moves, so that turns are often joined
+// (staying under the hard limit). A client taking no messages has to be disconnected by the end
+// of the game. Returns false if the games differ or it isn't disconnected.
+bool check_catch_up_turns(uint64_t boards) {
+    std::vector<ClientMessage> client_messages = get_game_messages();
+    uint64_t coalesced_turns = 0;
+    for (uint32_t seed = 1; seed <= boards; seed++) {
+        std::minstd_rand random(seed);
+        GameState game_state;
+        auto size = (coordinate_t) (random() % 16 + 2);
+        prepare_game_state(game_state, size, 0, 0, 8);
+        game_state.seed = seed;
+        game_state.initial_blocks = (initial_blocks_t) (size * size / 4);
+        game_state.bomb_timer = (bomb_timer_t) (random() % 4 + 1);
+        game_state.explosion_radius = (explosion_radius_t) (random() % 4);
+        game_state.game_length = 100;
+        game_state.resize_board();
+        std::map<client_id_t, player_id_t> client_to_player_id;
+        BlockingMessageQueue pending_messages;
+        GameManager game_manager(game_state, client_to_player_id, pending_messages);
+        auto send_message = [&] {
+            game_manager.add_past_message(pending_messages.pop());
+        };
+        game_manager.start_game();
+        send_message(); // GameStarted.
+
+        ServerOptions options;
+        options.max_queued_messages = 3;
+        options.slow_client_policy = SlowClientPolicy::Coalesce;
+        ServerOptions reference_options;
+        ClientQueueMetrics metrics;
+        ClientQueue client_queue(game_manager.get_message_log(), options, metrics);
+        ClientQueue reference_queue(game_manager.get_message_log(), reference_options, metrics);
+        GameState client_game_state;
+        GameState reference_game_state;
+        bool compact = seed % 2 == 0;
+        std::vector<const EncodedMessage *> messages;
+        std::map<turn_t, std::vector<char>> reference_draws;
+        std::vector<char> draw;
+        std::vector<char> reference_draw;
+
+        game_manager.initialize_game_state();
+        send_message(); // Turn.
+        turn_t turn = 1;
+        while (turn <= game_state.game_length + 1) {
+            for (size_t behind = random() % 8 + 1; behind > 0; behind--) {
+                if (turn > game_state.game_length) {
+                    game_manager.end_game();
+                    send_message(); // GameEnded.
+                    turn++;
+                    break;
+                }
+                TurnMessages turn_messages;
+                for (player_id_t player_id = 0; player_id < 8; player_id++) {
+                    size_t action = random() % 32;
+                    if (action < 4) {
+                        // PlaceBomb or PlaceBlock.
+                        turn_messages[player_id] = PlayerInput(client_messages[action % 2]);
+                    } else if (action < 24) {
+                        turn_messages[player_id] = PlayerInput(client_messages[2 + action % 4]);
+                    }
+                }
+                game_manager.run_turn(turn++, turn_messages);
+                send_message();
+            }
+
+            reference_draws.clear();
+            messages.clear();
+            while (reference_queue.read(messages, SIZE_MAX)) {
+                for (const EncodedMessage *message: messages) {
+                    reference_draw = decode_message(*message, compact, reference_game_state);
+                    if (message->get_type() == ServerMessageType::Turn) {
+                        reference_draws[reference_game_state.turn] = reference_draw;
+                    }
+                }
+                messages.clear();
+            }
+            while (client_queue.read(messages, SIZE_MAX)) {
+                for (const EncodedMessage *message: messages) {
+                    draw = decode_message(*message, compact, client_game_state);
+                    if (message->get_type() == ServerMessageType::Turn &&
+                        draw != reference_draws[client_game_state.turn]) {
+                        std::cerr << "Client catching up differs in turn "
+                                  << client_game_state.turn << " on board " << seed << "\n";
+                        return false;
+                    }
+                }
+                messages.clear();
+            }
+            if (draw != reference_draw) {
+                std::cerr << "Client catching up differs after turn " << client_game_state.turn
+                          << " on board " << seed << "\n";
+                return false;
+            }
+        }
+        ClientQueue stalled_queue(game_manager.get_message_log(), options, metrics);
+        if (!stalled_queue.should_disconnect()) {
+            std::cerr << "Client taking no messages not disconnected on board " << seed << "\n";
+            return false;
+        }
+        coalesced_turns += metrics.coalesced_turns;
+    }
+    if (coalesced_turns == 0) {
+        std::cerr << "No Turn messages coalesced on " << boards << " boards\n";
+        return false;
+    }
+    std::cout << "Games on " << boards << " boards the same for a client catching up with "
+              << coalesced_turns << " Turn messages coalesced\n";
+    return true;
+}
+
+// Checks that turns of the games measured by 'bench_turns' and 'bench_player_actions', once they
+// are in a steady state, don't call operator new on the thread running the game. Returns false
+// if they do.
+bool check_turn_allocations() {
+    struct Setup {
+        player_id_t players;
+        size_t blocks;
+        bomb_timer_t bomb_timer;
+        size_t action_threads;
+    };
+    for (Setup setup: std::initializer_list<Setup>{
+            {BENCH_PLAYERS, 0, 5, 1}, {BENCH_PLAYERS, 0, 1000, 1},
+            {LARGE_ROOM_PLAYERS, BENCH_BLOCKS, BENCH_BOMB_TIMER, 1},
+            {LARGE_ROOM_PLAYERS, BENCH_BLOCKS, BENCH_BOMB_TIMER, 4}}) {
+        BenchGame game(setup.players, setup.blocks, setup.bomb_timer, setup.action_threads);
+        game.warm_up();
+        uint64_t allocations = get_allocations();
+        for (size_t i = 0; i < CHECKED_TURNS; i++) {
+            game.run_turn();
+        }
+        allocations = get_allocations() - allocations;
+        if (allocations != 0) {
+            std::cerr << CHECKED_TURNS << " turns of " << (int) setup.players << " players "
+                      << "with bomb timer " << setup.bomb_timer << " and "
+                      << setup.action_threads << " action threads made " << allocations
+                      << " allocations\n";
+            return false;
+        }
+    }
+    std::cout << "Turns of games in a steady state don't allocate memory\n";
+    return true;
+}
+
+int main(int argc, char **argv) {
+    try {
+        po::options_description options_description("Benchmark parameters");
+        int64_t min_time;
+        uint64_t check_boards;
+        BenchOptions options;
+        options_description.add_options()(
+            "help,h", "Produce help message"
+        )("min-time,t", po::value<int64_t>(&min_time)->default_value(200),
+            "Minimal duration of every measurement in milliseconds"
+        )("filter,f", po::value<std::string>(&options.filter)->default_value(""),
+            "Run only measurements with names containing this string"
+        )("check", po::value<uint64_t>(&check_boards)->implicit_value(1000),
+            "Instead of measuring, check that explosion engines (and calculating explosions and "
+            "evaluating actions of players in parallel, and clients catching up with coalesced "
+            "Turn messages) agree on this many random boards, and that turns of a game in a "
+            "steady state don't allocate memory");
+        po::variables_map variables_map;
+        po::store(po::parse_command_line(argc, argv, options_description), variables_map);
+        if (variables_map.count("help")) {
+            std::cout << options_description;
+            return 0;
+        }
+        po::notify(variables_map);
+        options.min_time = std::chrono::milliseconds(min_time);
+
+        if (variables_map.count("check")) {
+            return check_explosion_engines(check_boards) && check_explosion_pool(check_boards) &&
+                   check_player_actions(check_boards) && check_catch_up_turns(check_boards) &&
+                   check_turn_allocations() ? 0 : EXIT_FAILURE;
+        }
+
+        bench_server_messages(options);
+        bench_client_messages(options);
+        bench_input_messages(options);
+        bench_draw_messages(options);
+        bench_explosions(options);
+        bench_turns(options);
+        bench_player_actions(options);
+        bench_parallel_explosions(options);
+    } catch (std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        exit(EXIT_FAILURE);
+    }
+}
@@ -0,0 +1,125 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include "../common/messages.h"
+
+// Fuzz target for decoding messages received by server (ClientMessage) and client
+// (ServerMessage). Incorrect input may only end decoding with an exception. Built with
+// ROBOTS_LIBFUZZER it is a libFuzzer target, otherwise it has its own driver mutating correct
+// messages (or replaying inputs given as arguments).
+
+// Decodes all messages of the input: as a stream of client messages and as a stream of server
+// messages.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    BufferMemory buffer;
+    try {
+        buffer.load((const char *) data, size);
+        while (!buffer.is_read()) {
+            ClientMessage client_message(buffer);
+            if (!client_message.is_correct()) {
+                break;
+            }
+        }
+    } catch (std::invalid_argument &e) {
+        // Incomplete or incorrect message.
+    }
+
+    GameState game_state;
+    game_state.type = GameStateType::Lobby;
+    try {
+        buffer.load((const char *) data, size);
+        while (!buffer.is_read()) {
+            ServerMessage server_message(buffer, game_state);
+            if (server_message.should_send_message_to_gui()) {
+                DrawMessage draw_message(server_message, game_state);
+                BufferMemory draw_buffer;
+                draw_message.insert_to_buffer(draw_buffer, game_state);
+            }
+        }
+    } catch (std::invalid_argument &e) {
+        // Incomplete or incorrect message.
+    }
+    return 0;
+}
+
+#ifndef ROBOTS_LIBFUZZER
+
+constexpr size_t DEFAULT_ITERATIONS = 200000;
+constexpr size_t MAX_MUTATIONS = 8;
+
+// Correct messages that are mutated.
+std::vector<std::vector<uint8_t>> get_seeds() {
+    return {
+            // Join, Move, PlaceBomb, PlaceBlock.
+            {0, 3, 'a', 'b', 'c', 3, 1, 1, 2},
+            // Hello: "s", 2 players, 10x10, 100 turns, radius 3, timer 5.
+            {0, 1, 's', 2, 0, 10, 0, 10, 0, 100, 0, 3, 0, 5},
+            // AcceptedPlayer 0 "a" "b", GameStarted with 1 player.
+            {1, 0, 1, 'a', 1, 'b', 2, 0, 0, 0, 1, 0, 1, 'a', 1, 'b'},
+            // Hello, Turn 1: BombPlaced 0 at (1, 2), PlayerMoved 0 to (3, 4), BlockPlaced (5, 6),
+            // BombExploded 0 destroying robot 0 and block (5, 6), GameEnded with score 1.
+            {0, 1, 's', 1, 0, 10, 0, 10, 0, 100, 0, 3, 0, 5,
+             3, 0, 1, 0, 0, 0, 4,
+             0, 0, 0, 0, 0, 0, 1, 0, 2,
+             2, 0, 0, 3, 0, 4,
+             3, 0, 5, 0, 6,
+             1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 5, 0, 6,
+             4, 0, 0, 0, 1, 0, 0, 0, 0, 1},
+            // The same turn as two CompactTurn messages (BombPlaced, PlayerMoved and BlockPlaced
+            // in turn 1, BombExploded in turn 2).
+            {0, 1, 's', 1, 0, 10, 0, 10, 0, 100, 0, 3, 0, 5,
+             5, 1, 0, 1, 0, 1, 2, 1, 0, 3, 4, 1, 5, 6,
+             5, 2, 1, 0, 1, 0, 1, 5, 6, 0, 0, 0},
+    };
+}
+
+void mutate(std::vector<uint8_t> &input, std::minstd_rand &random) {
+    size_t mutations = random() % MAX_MUTATIONS + 1;
+    for (size_t i = 0; i < mutations; i++) {
+        switch (random() % 4) {
+            case 0: // Change a byte.
+                if (!input.empty()) {
+                    input[random() % input.size()] = (uint8_t) random();
+                }
+                break;
+            case 1: // Insert a byte.
+                input.insert(input.begin() + (long) (random() % (input.size() + 1)),
+                             (uint8_t) random());
+                break;
+            case 2: // Remove a byte.
+                if (!input.empty()) {
+                    input.erase(input.begin() + (long) (random() % input.size()));
+                }
+                break;
+            default: // Truncate.
+                input.resize(random() % (input.size() + 1));
+                break;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && std::string(argv[1]) != "--iterations") {
+        // Replay inputs.
+        for (int i = 1; i < argc; i++) {
+            std::ifstream file(argv[i], std::ios::binary);
+            std::vector<uint8_t> input((std::istreambuf_iterator<char>(file)),
+                                       std::istreambuf_iterator<char>());
+            LLVMFuzzerTestOneInput(input.data(), input.size());
+        }
+        return 0;
+    }
+    size_t iterations = argc > 2 ? std::stoull(argv[2]) : DEFAULT_ITERATIONS;
+    std::minstd_rand random(1);
+    std::vector<std::vector<uint8_t>> seeds = get_seeds();
+    for (size_t i = 0; i < iterations; i++) {
+        std::vector<uint8_t> input = seeds[random() % seeds.size()];
+        mutate(input, random);
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+    printf("%zu inputs decoded\n", iterations);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,241 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <thread>
+#include "../common/game_engine.h"
+#include "../common/program_options.h"
+
+// Simulates many independent games with the engine of the server (without sockets and without
+// waiting for turns to pass), on all cores. Players send random messages or messages from a
+// script. Results are the same for the same parameters whatever the number of threads, so
+// their checksum can be compared between versions of the engine.
+
+// Messages a player can send during a game.
+const std::array<ClientMessage, 6> GAME_MESSAGES = {
+        ClientMessage(ClientMessageType::PlaceBomb), ClientMessage(ClientMessageType::PlaceBlock),
+        ClientMessage(Direction::Up), ClientMessage(Direction::Right),
+        ClientMessage(Direction::Down), ClientMessage(Direction::Left)};
+// Characters of the script for the messages above, and for no message.
+constexpr std::string_view SCRIPT_MESSAGES = "BKURDL";
+constexpr char SCRIPT_NO_MESSAGE = '.';
+
+struct SimulationOptions {
+    uint64_t games = 1;
+    size_t threads = 1;
+    // Messages of players in consecutive turns: a line for every turn and a character for every
+    // player (both repeated if there are more turns or players). Empty for random messages.
+    std::vector<std::string> script;
+    bool print_games = false;
+};
+
+struct GameResult {
+    std::vector<score_t> scores; // In the order of player ids.
+    uint64_t robots_destroyed = 0;
+    uint64_t blocks_destroyed = 0;
+};
+
+// Reads a script, checking that it contains only known messages.
+std::vector<std::string> read_script(const std::string &path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::invalid_argument("Can't open script " + path);
+    }
+    std::vector<std::string> script;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        for (char message: line) {
+            if (message != SCRIPT_NO_MESSAGE && SCRIPT_MESSAGES.find(message) ==
+                                                std::string_view::npos) {
+                throw std::invalid_argument(std::string("Incorrect message in script: ") +
+                                            message);
+            }
+        }
+        script.push_back(line);
+    }
+    if (script.empty()) {
+        throw std::invalid_argument("Empty script " + path);
+    }
+    return script;
+}
+
+// Plays game number 'game' of the simulation: its seed is the seed of 'rules' plus 'game'.
+GameResult simulate_game(const GameState &rules, const SimulationOptions &options, uint64_t game) {
+    GameState game_state;
+    game_state.type = GameStateType::Game;
+    game_state.set_rules(rules);
+    game_state.seed = (seed_t) (rules.seed + game);
+    game_state.resize_board();
+    for (player_id_t player_id = 0; player_id < rules.players_count; player_id++) {
+        game_state.players[player_id] = Player("Player " + std::to_string(player_id),
+                                               "simulation");
+        game_state.scores[player_id] = 0;
+    }
+
+    GameEngine game_engine(game_state);
+    game_engine.initialize_game_state();
+    std::mt19937 random(game_state.seed);
+    GameResult result;
+    for (turn_t turn = 1; turn <= game_state.game_length; turn++) {
+        TurnMessages turn_messages;
+        for (player_id_t player_id = 0; player_id < rules.players_count; player_id++) {
+            size_t message;
+            if (options.script.empty()) {
+                // No message in one of 7 turns.
+                message = random() % (GAME_MESSAGES.size() + 1);
+                if (message == GAME_MESSAGES.size()) {
+                    continue;
+                }
+            } else {
+                const std::string &line = options.script[(turn - 1) % options.script.size()];
+                message = SCRIPT_MESSAGES.find(line[player_id % line.size()]);
+                if (message == std::string_view::npos) {
+                    continue;
+                }
+            }
+            turn_messages[player_id] = PlayerInput(GAME_MESSAGES[message]);
+        }
+        const TurnEvents &events = game_engine.run_turn(turn, turn_messages);
+        result.robots_destroyed += events.get_robots_destroyed().size();
+        result.blocks_destroyed += events.get_blocks_destroyed().size();
+    }
+    for (auto const & [player_id, score]: game_state.scores) {
+        result.scores.push_back(score);
+    }
+    return result;
+}
+
+// Hashes results of all games (in the order of games) with FNV-1a.
+uint64_t get_checksum(const std::vector<GameResult> &results) {
+    uint64_t checksum = 14695981039346656037ULL;
+    auto add = [&](uint64_t value) {
+        for (int byte = 0; byte < 8; byte++) {
+            checksum = (checksum ^ ((value >> (8 * byte)) & 0xff)) * 1099511628211ULL;
+        }
+    };
+    for (auto const & result: results) {
+        for (score_t score: result.scores) {
+            add(score);
+        }
+        add(result.robots_destroyed);
+        add(result.blocks_destroyed);
+    }
+    return checksum;
+}
+
+void simulate_games(const GameState &rules, const SimulationOptions &options) {
+    std::vector<GameResult> results(options.games);
+    std::atomic<uint64_t> next_game = 0;
+    ThreadPool thread_pool(options.threads);
+    auto start = std::chrono::steady_clock::now();
+    thread_pool.run(thread_pool.size(), [&](size_t) {
+        for (uint64_t game = next_game++; game < options.games; game = next_game++) {
+            results[game] = simulate_game(rules, options, game);
+        }
+    });
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    uint64_t robots_destroyed = 0;
+    uint64_t blocks_destroyed = 0;
+    for (uint64_t game = 0; game < options.games; game++) {
+        robots_destroyed += results[game].robots_destroyed;
+        blocks_destroyed += results[game].blocks_destroyed;
+        if (options.print_games) {
+            printf("Game %lu (seed %u): robots destroyed %lu, blocks destroyed %lu, scores",
+                   game, (seed_t) (rules.seed + game), results[game].robots_destroyed,
+                   results[game].blocks_destroyed);
+            for (score_t score: results[game].scores) {
+                printf(" %u", score);
+            }
+            printf("\n");
+        }
+    }
+    uint64_t turns = options.games * rules.game_length;
+    double seconds = elapsed.count();
+    printf("%lu games, %lu turns in %.2f s on %zu threads: %.0f turns/s (%.1f M turns/min)\n",
+           options.games, turns, seconds, thread_pool.size(), (double) turns / seconds,
+           (double) turns / seconds * 60 / 1e6);
+    printf("Robots destroyed: %lu, blocks destroyed: %lu, checksum: %016lx\n", robots_destroyed,
+           blocks_destroyed, get_checksum(results));
+}
+
+int main(int argc, char **argv) {
+    try {
+        po::options_description options_description("Simulation parameters");
+        options_description.add_options()(
+            "help,h", "Produce help message"
+        )("games,g", po::value<uint64_t>()->default_value(1000),
+            "Number of games simulated"
+        )("threads,t", po::value<simulation_threads_parsing_t>()->default_value(
+                (simulation_threads_parsing_t) std::max(std::thread::hardware_concurrency(), 1U)),
+            "Number of threads simulating games (default is the number of cores)"
+        )("script", po::value<std::string>(),
+            "File with messages of players: a line for every turn with a character for every "
+            "player, B (PlaceBomb), K (PlaceBlock), U, R, D, L (Move) or . (no message). By "
+            "default players send random messages"
+        )("print-games", po::bool_switch(),
+            "Print results of every game"
+        )("bomb-timer,b", po::value<bomb_timer_parsing_t>()->default_value(5),
+            "Number of turns after which a bomb explodes"
+        )("players-count,c", po::value<players_count_parsing_t>()->default_value(4),
+            "Number of players"
+        )("explosion-radius,e", po::value<explosion_radius_parsing_t>()->default_value(3),
+            "Radius of bomb explosions"
+        )("explosion-engine", po::value<std::string>()->default_value("bitboard"),
+            "Way of calculating explosions: bitboard, extents or reference"
+        )("initial-blocks,k", po::value<initial_blocks_parsing_t>()->default_value(50),
+            "Initial number of blocks on the board"
+        )("game-length,l", po::value<game_length_parsing_t>()->default_value(100),
+            "Length of a game in turns"
+        )("seed,s", po::value<seed_parsing_t>()->default_value(0),
+            "Seed of the first game (following games have the following seeds)"
+        )("size-x,x", po::value<coordinate_parsing_t>()->default_value(20),
+            "Horizontal size of the board"
+        )("size-y,y", po::value<coordinate_parsing_t>()->default_value(20),
+            "Vertical size of the board");
+        po::variables_map variables_map = get_variables_map(argc, argv, options_description);
+        if (variables_map.count("help")) {
+            std::cout << options_description;
+            return 0;
+        }
+        notify_variables_map(variables_map);
+
+        GameState rules;
+        rules.bomb_timer = parse(
+                variables_map["bomb-timer"].as<bomb_timer_parsing_t>(), "bomb-timer");
+        rules.players_count = parse(
+                variables_map["players-count"].as<players_count_parsing_t>(), "players-count");
+        rules.explosion_radius = parse(
+                variables_map["explosion-radius"].as<explosion_radius_parsing_t>(),
+                "explosion-radius");
+        rules.explosion_engine = parse_explosion_engine(
+                variables_map["explosion-engine"].as<std::string>(), "explosion-engine");
+        rules.initial_blocks = parse(
+                variables_map["initial-blocks"].as<initial_blocks_parsing_t>(), "initial-blocks");
+        rules.game_length = parse(
+                variables_map["game-length"].as<game_length_parsing_t>(), "game-length");
+        rules.seed = parse(variables_map["seed"].as<seed_parsing_t>(), "seed");
+        rules.size_x = parse(variables_map["size-x"].as<coordinate_parsing_t>(), "size-x");
+        rules.size_y = parse(variables_map["size-y"].as<coordinate_parsing_t>(), "size-y");
+        if (rules.size_x == 0 || rules.size_y == 0) {
+            throw po::error("the board has to have at least one field");
+        }
+
+        SimulationOptions options;
+        options.games = variables_map["games"].as<uint64_t>();
+        options.threads = parse(
+                variables_map["threads"].as<simulation_threads_parsing_t>(), "threads");
+        if (variables_map.count("script")) {
+            options.script = read_script(variables_map["script"].as<std::string>());
+        }
+        options.print_games = variables_map["print-games"].as<bool>();
+        simulate_games(rules, options);
+    } catch (std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        exit(EXIT_FAILURE);
+    }
+}
@@ -1,8 +1,11 @@
+#include <utility> // Needed by Boost.Asio headers on newer compilers.
 #include <boost/asio.hpp>
 #include <boost/program_options.hpp>
 #include <iostream>
 #include "../common/program_options.h"
 #include "../common/messages.h"
+#include "../common/socket_buffer.h"
+#include "../common/allocation_counter.h"
 
 namespace po = boost::program_options;
 namespace as = boost::asio;
@@ -10,10 +13,15 @@ namespace as = boost::asio;
 // Receives messages from GUI and forwards appropriate ones to server.
 void from_gui_to_server(as::ip::udp::socket &gui_socket, as::ip::udp::endpoint &gui_endpoint,
                         as::ip::tcp::socket &server_socket, GameState &game_state,
-                        const std::string &player_name) {
+                        const std::string &player_name, bool compact_encoding) {
     try {
         BufferUDP gui_buffer(gui_socket, gui_endpoint);
         BufferTCP server_buffer(server_socket);
+        if (compact_encoding) {
+            // Opt in to the compact encoding before any other message.
+            ClientMessage(ClientMessageType::UseCompactEncoding).insert_to_buffer(server_buffer);
+            server_buffer.send_message();
+        }
         do {
             gui_buffer.receive_message();
             InputMessage input_message(gui_buffer);
@@ -34,12 +42,32 @@ void from_gui_to_server(as::ip::udp::socket &gui_socket, as::ip::udp::endpoint &
 
 // Receives messages from server and forwards appropriate ones to GUI.
 void from_server_to_gui(as::ip::udp::socket &gui_socket, as::ip::udp::endpoint &gui_endpoint,
-                        as::ip::tcp::socket &server_socket, GameState &game_state) {
+                        as::ip::tcp::socket &server_socket, GameState &game_state,
+                        bool statistics) {
+    BufferTCP server_buffer(server_socket);
+    // Statistics of decoding Turn messages.
+    uint64_t turns = 0;
+    uint64_t turn_allocations = 0;
+    auto print_statistics = [&] {
+        if (statistics) {
+            server_buffer.print_statistics(std::cerr, "Server");
+            std::cerr << "Server: " << turns << " Turn messages decoded with " << turn_allocations
+                      << " allocations ("
+                      << (turns > 0 ? (double) turn_allocations / (double) turns : 0)
+                      << " per message)\n";
+        }
+    };
     try {
         BufferUDP gui_buffer(gui_socket, gui_endpoint);
-        BufferTCP server_buffer(server_socket);
         do {
+            uint64_t allocations = get_allocations();
             ServerMessage server_message(server_buffer, game_state);
+            server_buffer.count_received_message();
+            if (server_message.get_type() == ServerMessageType::Turn ||
+                server_message.get_type() == ServerMessageType::CompactTurn) {
+                turns++;
+                turn_allocations += get_allocations() - allocations;
+            }
             if (server_message.should_send_message_to_gui()) {
                 DrawMessage draw_message(server_message, game_state);
                 draw_message.insert_to_buffer(gui_buffer, game_state);
@@ -47,9 +75,11 @@ void from_server_to_gui(as::ip::udp::socket &gui_socket, as::ip::udp::endpoint &
             }
         } while (true);
     } catch (std::exception &e) {
+        print_statistics();
         std::cerr << "Error: " << e.what() << "\n";
         exit(EXIT_FAILURE);
     } catch (...) {
+        print_statistics();
         std::cerr << "Error: Exception of unknown type\n";
         exit(EXIT_FAILURE);
     }
@@ -83,6 +113,8 @@ int main(int argc, char **argv) {
         game_state.type = GameStateType::Lobby;
 
         std::string player_name = variables_map["player-name"].as<std::string>();
+        bool statistics = variables_map["statistics"].as<bool>();
+        bool compact_encoding = variables_map["compact-encoding"].as<bool>();
 
         Address server_address = parse_address(variables_map["server-address"].as<std::string>());
         server_endpoint = tcp_resolver.resolve(server_address.host, server_address.port);
@@ -99,14 +131,16 @@ int main(int argc, char **argv) {
         server_socket.set_option(as::ip::tcp::no_delay(true));
 
         std::thread thread_from_gui_to_server(
-                [&gui_socket, &gui_endpoint, &server_socket, &game_state, &player_name] {
+                [&gui_socket, &gui_endpoint, &server_socket, &game_state, &player_name,
+                 compact_encoding] {
                     from_gui_to_server(gui_socket, gui_endpoint, server_socket, game_state,
-                                       player_name);
+                                       player_name, compact_encoding);
                 });
 
         std::thread thread_from_server_to_gui(
-                [&gui_socket, &gui_endpoint, &server_socket, &game_state] {
-                    from_server_to_gui(gui_socket, gui_endpoint, server_socket, game_state);
+                [&gui_socket, &gui_endpoint, &server_socket, &game_state, statistics] {
+                    from_server_to_gui(gui_socket, gui_endpoint, server_socket, game_state,
+                                       statistics);
                 });
 
         thread_from_gui_to_server.join();
@@ -0,0 +1,29 @@
+#include "allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+    thread_local uint64_t allocations = 0;
+}
+
+uint64_t get_allocations() {
+    return allocations;
+}
+
+void *operator new(size_t size) {
+    allocations++;
+    void *pointer = malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void *pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void *pointer, [[maybe_unused]] size_t size) noexcept {
+    free(pointer);
+}
@@ -0,0 +1,10 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstdint>
+
+// Returns the number of global operator new calls made so far by the calling thread. Calls are
+// counted in programs linked with allocation_counter.cpp, which replaces operator new.
+uint64_t get_allocations();
+
+#endif //ALLOCATION_COUNTER_H
@@ -0,0 +1,61 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <algorithm>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+// Monotonic memory resource for temporary objects of a single turn. Memory is taken by bumping
+// a pointer and freed all at once by 'reset', which keeps the chunks for the next turn, so that
+// in a steady state a turn doesn't allocate memory.
+class TurnArena : public std::pmr::memory_resource {
+private:
+    static constexpr size_t CHUNK_SIZE = 16384;
+
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Chunk> chunks;
+    size_t current_chunk = 0;
+    size_t offset = 0; // In the current chunk.
+
+    void *do_allocate(size_t bytes, size_t alignment) override {
+        while (current_chunk < chunks.size()) {
+            Chunk &chunk = chunks[current_chunk];
+            size_t aligned_offset = (offset + alignment - 1) & ~(alignment - 1);
+            if (aligned_offset + bytes <= chunk.size) {
+                offset = aligned_offset + bytes;
+                return chunk.data.get() + aligned_offset;
+            }
+            // Memory left in the chunk is wasted until the next reset.
+            current_chunk++;
+            offset = 0;
+        }
+        // Chunks are aligned as 'operator new' memory, larger alignments need padding.
+        size_t size = std::max(CHUNK_SIZE, bytes + alignment);
+        chunks.push_back({std::make_unique<char[]>(size), size});
+        return do_allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *, size_t, size_t) override {}
+
+    [[nodiscard]] bool do_is_equal(const memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+public:
+    TurnArena() = default;
+    TurnArena(const TurnArena &) = delete;
+    TurnArena &operator=(const TurnArena &) = delete;
+
+    // Frees all memory taken since the last reset. Objects using it have to be destroyed before.
+    void reset() {
+        current_chunk = 0;
+        offset = 0;
+    }
+};
+
+#endif //ARENA_H
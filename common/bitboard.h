@@ -0,0 +1,111 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+#include "types.h"
+
+// Ways of calculating explosions: field by field (the reference way), using bitsets of rows
+// and columns of the board with blocks, or using distances to the nearest blocks kept for every
+// field (see blast_extents.h).
+enum class ExplosionEngine {
+    Reference,
+    Bitboard,
+    Extents
+};
+
+// Largest board (in fields) for which bitsets of rows and columns are kept. Both take
+// 2 * size_x * size_y bits (and a word of padding per row and column).
+constexpr size_t BITBOARD_MAX_FIELDS = (size_t) 1 << 24;
+
+// Returned by 'find_last_set' and 'find_first_set' if there is no bit set.
+constexpr size_t NO_BIT = SIZE_MAX;
+
+// Returns the highest bit set among bits 'from'..'to' (inclusive) of 'words'.
+inline size_t find_last_set(const uint64_t *words, size_t from, size_t to) {
+    size_t word = to / 64;
+    // Bits of the last word up to 'to'.
+    uint64_t bits = words[word] & (~UINT64_C(0) >> (63 - to % 64));
+    while (true) {
+        if (word == from / 64) {
+            bits &= ~UINT64_C(0) << (from % 64);
+        }
+        if (bits != 0) {
+            return word * 64 + 63 - (size_t) std::countl_zero(bits);
+        }
+        if (word == from / 64) {
+            return NO_BIT;
+        }
+        bits = words[--word];
+    }
+}
+
+// Returns the lowest bit set among bits 'from'..'to' (inclusive) of 'words'.
+inline size_t find_first_set(const uint64_t *words, size_t from, size_t to) {
+    size_t word = from / 64;
+    // Bits of the first word from 'from'.
+    uint64_t bits = words[word] & (~UINT64_C(0) << (from % 64));
+    while (true) {
+        if (word == to / 64) {
+            bits &= ~UINT64_C(0) >> (63 - to % 64);
+        }
+        if (bits != 0) {
+            return word * 64 + (size_t) std::countr_zero(bits);
+        }
+        if (word == to / 64) {
+            return NO_BIT;
+        }
+        bits = words[++word];
+    }
+}
+
+// Blocks on the board kept as a bitset of every row (bit x of row y) and of every column (bit y
+// of column x), so the first block in any direction from a field is found with a few bit scans.
+class BlockBitboard {
+private:
+    size_t row_words = 0;
+    size_t column_words = 0;
+    std::vector<uint64_t> rows;
+    std::vector<uint64_t> columns;
+
+public:
+    // Empties the bitboard and sizes it for a board of given size (or disables it if 'enabled'
+    // is false).
+    void resize(coordinate_t size_x, coordinate_t size_y, bool enabled) {
+        row_words = enabled ? ((size_t) size_x + 63) / 64 : 0;
+        column_words = enabled ? ((size_t) size_y + 63) / 64 : 0;
+        rows.assign(enabled ? row_words * size_y : 0, 0);
+        columns.assign(enabled ? column_words * size_x : 0, 0);
+    }
+
+    [[nodiscard]] bool is_enabled() const {
+        return !rows.empty();
+    }
+
+    void insert(coordinate_t x, coordinate_t y) {
+        rows[y * row_words + x / 64] |= UINT64_C(1) << (x % 64);
+        columns[x * column_words + y / 64] |= UINT64_C(1) << (y % 64);
+    }
+
+    void erase(coordinate_t x, coordinate_t y) {
+        rows[y * row_words + x / 64] &= ~(UINT64_C(1) << (x % 64));
+        columns[x * column_words + y / 64] &= ~(UINT64_C(1) << (y % 64));
+    }
+
+    void clear() {
+        std::fill(rows.begin(), rows.end(), 0);
+        std::fill(columns.begin(), columns.end(), 0);
+    }
+
+    [[nodiscard]] const uint64_t *get_row(coordinate_t y) const {
+        return rows.data() + y * row_words;
+    }
+
+    [[nodiscard]] const uint64_t *get_column(coordinate_t x) const {
+        return columns.data() + x * column_words;
+    }
+};
+
+#endif //BITBOARD_H
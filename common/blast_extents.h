@@ -0,0 +1,120 @@
+#ifndef BLAST_EXTENTS_H
+#define BLAST_EXTENTS_H
+
+#include <cstdint>
+#include <vector>
+#include "types.h"
+
+// Largest board (in fields) for which blast extents are kept. They take 8 bytes per field.
+constexpr size_t BLAST_EXTENTS_MAX_FIELDS = (size_t) 1 << 22;
+
+// For every field of the board, the distance to the nearest block (or to the edge of the board
+// if there is no block) in each of the four directions, counting a block on the field itself
+// as distance 0. An explosion ray from a field ends after the smaller of this distance and the
+// explosion radius. Distances are updated when blocks are inserted or erased, which changes
+// only the fields between the block and the next blocks in its row and column.
+class BlastExtents {
+private:
+    coordinate_t size_x{};
+    coordinate_t size_y{};
+    // Distances along rows are kept row by row, distances along columns column by column.
+    std::vector<coordinate_t> left;
+    std::vector<coordinate_t> right;
+    std::vector<coordinate_t> down;
+    std::vector<coordinate_t> up;
+
+    [[nodiscard]] size_t get_row_index(size_t x, size_t y) const {
+        return y * size_x + x;
+    }
+
+    [[nodiscard]] size_t get_column_index(size_t x, size_t y) const {
+        return x * size_y + y;
+    }
+
+    // Updates distances to the nearest block or end of a line of 'length' fields ('before' -
+    // towards lower coordinates, 'after' - towards higher ones) after a block was inserted on
+    // or erased from 'field' of the line. 'is_block' tells if a field of the line has a block.
+    template <typename IsBlock>
+    static void update_line(coordinate_t *before, coordinate_t *after, size_t length,
+                            size_t field, IsBlock &&is_block) {
+        // The nearest blocks (or ends of the line) before and after the field.
+        size_t previous_stop = field;
+        if (!is_block(field) && field > 0) {
+            previous_stop = field - 1 - before[field - 1];
+        }
+        size_t next_stop = field;
+        if (!is_block(field) && field < length - 1) {
+            next_stop = field + 1 + after[field + 1];
+        }
+        // Fields from the field to the next block have the same nearest block before them.
+        for (size_t i = field; i < length && (i == field || !is_block(i)); i++) {
+            before[i] = (coordinate_t) (i - previous_stop);
+        }
+        // Fields from the previous block to the field have the same nearest block after them.
+        for (size_t i = field + 1; i-- > 0 && (i == field || !is_block(i));) {
+            after[i] = (coordinate_t) (next_stop - i);
+        }
+    }
+
+public:
+    // Sizes the extents for an empty board of given size (or disables them if 'enabled' is
+    // false).
+    void resize(coordinate_t new_size_x, coordinate_t new_size_y, bool enabled) {
+        size_x = enabled ? new_size_x : 0;
+        size_y = enabled ? new_size_y : 0;
+        size_t fields = (size_t) size_x * size_y;
+        left.resize(fields);
+        right.resize(fields);
+        down.resize(fields);
+        up.resize(fields);
+        clear();
+    }
+
+    [[nodiscard]] bool is_enabled() const {
+        return !left.empty();
+    }
+
+    // Sets the extents of an empty board.
+    void clear() {
+        for (size_t y = 0; y < size_y; y++) {
+            for (size_t x = 0; x < size_x; x++) {
+                left[get_row_index(x, y)] = (coordinate_t) x;
+                right[get_row_index(x, y)] = (coordinate_t) (size_x - 1 - x);
+                down[get_column_index(x, y)] = (coordinate_t) y;
+                up[get_column_index(x, y)] = (coordinate_t) (size_y - 1 - y);
+            }
+        }
+    }
+
+    // Updates the extents after a block was inserted on or erased from (x, y). 'is_block(x, y)'
+    // tells if a field has a block (after the change).
+    template <typename IsBlock>
+    void update(coordinate_t x, coordinate_t y, IsBlock &&is_block) {
+        update_line(&left[get_row_index(0, y)], &right[get_row_index(0, y)], size_x, x,
+                    [&](size_t field_x) {
+                        return is_block((coordinate_t) field_x, y);
+                    });
+        update_line(&down[get_column_index(x, 0)], &up[get_column_index(x, 0)], size_y, y,
+                    [&](size_t field_y) {
+                        return is_block(x, (coordinate_t) field_y);
+                    });
+    }
+
+    [[nodiscard]] coordinate_t get_left(coordinate_t x, coordinate_t y) const {
+        return left[get_row_index(x, y)];
+    }
+
+    [[nodiscard]] coordinate_t get_right(coordinate_t x, coordinate_t y) const {
+        return right[get_row_index(x, y)];
+    }
+
+    [[nodiscard]] coordinate_t get_down(coordinate_t x, coordinate_t y) const {
+        return down[get_column_index(x, y)];
+    }
+
+    [[nodiscard]] coordinate_t get_up(coordinate_t x, coordinate_t y) const {
+        return up[get_column_index(x, y)];
+    }
+};
+
+#endif //BLAST_EXTENTS_H
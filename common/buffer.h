@@ -1,27 +1,49 @@
 #ifndef BUFFER_H
 #define BUFFER_H
 
-#include <boost/asio.hpp>
+#include <cstring>
 #include <iostream>
 #include "types.h"
 
-namespace as = boost::asio;
-
 // Buffer sizes.
 constexpr size_t UDP_BUFFER_SIZE = 65507;
 constexpr size_t TCP_BUFFER_SIZE = 4096;
 
+// Progress of measuring a message of which only a beginning is available, kept between calls
+// of a measuring function so that it resumes where it stopped when more bytes arrive.
+struct MeasureProgress {
+    size_t length = 0; // Length of the parts of the message measured so far.
+    size_t needed = 0; // Length of the beginning of the message needed to measure further.
+    unsigned stage = 0; // Part of the message measured next (meaning depends on the message).
+    uint64_t left = 0; // Elements left in the list measured now.
+    uint64_t nested_left = 0; // Elements left in a list nested in an element of that list.
+};
+
 class Buffer {
 protected:
     char *buffer;
     size_t size;
     size_t index = 0; // Pointer.
     size_t message_length = 0;
+    bool owns_memory = true;
 
     explicit Buffer(size_t buffer_size) : size(buffer_size) {
         buffer = new char[buffer_size];
     }
 
+    // Buffer using memory owned by the caller.
+    explicit Buffer(char *memory, size_t buffer_size) :
+            buffer(memory), size(buffer_size), owns_memory(false) {}
+
+    // Moves the content of buffer to a new, bigger one.
+    void grow(size_t new_size) {
+        char *new_buffer = new char[new_size];
+        memcpy(new_buffer, buffer, std::max(index, message_length));
+        delete[] buffer;
+        buffer = new_buffer;
+        size = new_size;
+    }
+
     // Resets value of variables 'index' and 'message_length'. Called after sending a message
     // and before receiving one if needed.
     void reset() {
@@ -39,6 +61,44 @@ protected:
     virtual void free([[maybe_unused]] size_t value_size) {}
 
 public:
+    // Functions taking (for reading) or reserving (for writing) a contiguous sequence of
+    // 'value_size' bytes of buffer with a single bounds check. They increase the value of the
+    // variable 'index' accordingly and return a pointer to the sequence.
+    const char *take(size_t value_size) {
+        fill(value_size);
+        const char *data = buffer + index;
+        index += value_size;
+        return data;
+    }
+
+    char *reserve(size_t value_size) {
+        free(value_size);
+        char *data = buffer + index;
+        index += value_size;
+        message_length += value_size;
+        return data;
+    }
+
+    // Takes a whole message kept contiguously in buffer. Its length is computed by 'measure'
+    // from the available beginning of the message and stored in 'length'. If more bytes are
+    // needed, 'measure' returns 0 and stores in its progress how many, so that they are filled
+    // at once and only the new ones are measured then. A single fill is limited to the size
+    // of buffer, so that a corrupted length doesn't allocate a huge buffer before any byte.
+    const char *take_message(size_t (*measure)(const char *data, size_t available,
+                                               MeasureProgress &progress),
+                             size_t &length) {
+        MeasureProgress progress;
+        size_t available = message_length - index;
+        while ((length = measure(buffer + index, available, progress)) == 0) {
+            fill(std::min(progress.needed, available + size));
+            if (message_length - index == available) {
+                throw std::invalid_argument("Incomplete message");
+            }
+            available = message_length - index;
+        }
+        return take(length);
+    }
+
     // Functions reading from buffer a sequence of 'size' bytes and storing it in a variable
     // 'value'. If needed they convert read value to host byte order. They increase the value
     // of the variable 'index' accordingly.
@@ -73,76 +133,67 @@ public:
     }
 
     virtual ~Buffer() {
-        delete[] buffer;
+        if (owns_memory) {
+            delete[] buffer;
+        }
     }
 };
 
-class BufferUDP : public Buffer {
+// Buffer kept in memory, growing when needed. Used to encode messages without sockets, and to
+// decode messages loaded into it (reading past the loaded bytes throws).
+class BufferMemory : public Buffer {
 private:
-    as::ip::udp::socket &socket;
-    as::ip::udp::endpoint endpoint;
+    void fill(size_t value_size) override {
+        if (index + value_size > message_length) {
+            throw std::invalid_argument("Incomplete message");
+        }
+    }
 
-    void receive_message([[maybe_unused]] size_t value_size) override {
-        // Message fits in a UDP datagram, so load the whole message immediately
-        // (the argument is a dummy).
-        reset();
-        message_length = socket.receive(as::buffer(buffer, size));
+    void free(size_t value_size) override {
+        // Grow the buffer (at least twice) if given variable won't fit in it.
+        if (index + value_size > size) {
+            grow(std::max(2 * size, index + value_size));
+        }
     }
 
 public:
-    BufferUDP(as::ip::udp::socket &socket, as::ip::udp::endpoint endpoint) :
-            Buffer(UDP_BUFFER_SIZE), socket(socket), endpoint(std::move(endpoint)) {}
+    explicit BufferMemory(size_t buffer_size = TCP_BUFFER_SIZE) : Buffer(buffer_size) {}
 
-    void receive_message() {
-        receive_message(size);
+    // Discards the content of buffer.
+    void clear() {
+        reset();
     }
 
-    void send_message() override {
-        socket.send_to(as::buffer(buffer, index), endpoint);
+    // Replaces the content of buffer with 'length' bytes to be read.
+    void load(const char *data, size_t length) {
         reset();
+        memcpy(reserve(length), data, length);
+        index = 0;
     }
-};
 
-class BufferTCP : public Buffer {
-private:
-    as::ip::tcp::socket &socket;
-
-    void receive_message(size_t value_size) override {
-        boost::system::error_code error;
-        as::read(socket, as::buffer(buffer + index, value_size), error);
-        if (error == as::error::eof) {
-            throw std::invalid_argument("Connection closed cleanly by peer");
-        } else if (error) {
-            throw boost::system::system_error(error);
-        }
-        message_length += value_size;
+    // Returns true if all loaded bytes were read.
+    [[nodiscard]] bool is_read() const {
+        return index == message_length;
     }
 
-    void fill(size_t value_size) override {
-        // With TCP, load to buffer exactly 'value_size' bytes. If there aren't at least
-        // this many free bytes in buffer reset values of variables 'index' and
-        // 'message_length' (as buffer will be overwritten).
-        if (index + value_size > size) {
-            reset();
-        }
-         receive_message(value_size);
+    // Returns the encoded message.
+    [[nodiscard]] const char *get_data() const {
+        return buffer;
     }
+};
 
+// Buffer of a fixed size, in memory owned by the caller. Used to encode a message whose length
+// was computed beforehand.
+class BufferFixed : public Buffer {
+private:
     void free(size_t value_size) override {
-        // If given variable won't fit in buffer send the datagram created so far.
         if (index + value_size > size) {
-            send_message();
+            throw std::length_error("Message longer than its computed length");
         }
     }
 
 public:
-    explicit BufferTCP(as::ip::tcp::socket &socket) :
-            Buffer(TCP_BUFFER_SIZE), socket(socket) {}
-
-    void send_message() override {
-        as::write(socket, as::buffer(buffer, index));
-        reset();
-    }
+    BufferFixed(char *memory, size_t buffer_size) : Buffer(memory, buffer_size) {}
 };
 
-#endif //BUFFER_H
\ No newline at end of file
+#endif //BUFFER_H
@@ -0,0 +1,387 @@
+#include "compact.h"
+#include "messages.h"
+
+#include <algorithm>
+#include <bitset>
+
+namespace {
+    constexpr uint8_t VARINT_CONTINUATION = 0x80;
+    constexpr uint8_t VARINT_BITS = 7;
+    constexpr size_t VARINT_MAX_SIZE = 10;
+
+    void insert_varint(Buffer &buffer, uint64_t value) {
+        char bytes[VARINT_MAX_SIZE];
+        size_t length = 0;
+        while (value >= VARINT_CONTINUATION) {
+            bytes[length++] = (char) (uint8_t) (value | VARINT_CONTINUATION);
+            value >>= VARINT_BITS;
+        }
+        bytes[length++] = (char) (uint8_t) value;
+        memcpy(buffer.reserve(length), bytes, length);
+    }
+
+    void insert_positions(Buffer &buffer, std::vector<Position> &positions) {
+        std::sort(positions.begin(), positions.end());
+        insert_varint(buffer, positions.size());
+        Position previous(0, 0);
+        for (auto const & position: positions) {
+            insert_varint(buffer, position.get_x() - previous.get_x());
+            if (position.get_x() == previous.get_x()) {
+                insert_varint(buffer, position.get_y() - previous.get_y());
+            } else {
+                insert_varint(buffer, position.get_y());
+            }
+            previous = position;
+        }
+    }
+
+    // Reads compact messages. Reading past the end of the message throws, or (when only
+    // measuring the message) marks it as incomplete.
+    class Reader {
+    private:
+        const char *data;
+        const char *end;
+
+        // Marks the message as incomplete, with at least 'missing' bytes past the end needed.
+        void set_incomplete(size_t missing) {
+            if (!incomplete) {
+                incomplete = true;
+                missing_length = missing;
+            }
+        }
+
+    public:
+        bool incomplete = false;
+        size_t missing_length = 0;
+
+        Reader(const char *data, size_t length) : data(data), end(data + length) {}
+
+        [[nodiscard]] size_t get_read_length(const char *start) const {
+            return (size_t) (data - start);
+        }
+
+        uint64_t get_varint() {
+            uint64_t value = 0;
+            for (unsigned shift = 0; shift < VARINT_MAX_SIZE * VARINT_BITS; shift += VARINT_BITS) {
+                if (data == end) {
+                    set_incomplete(1);
+                    return 0;
+                }
+                auto byte = (uint8_t) *data++;
+                value |= (uint64_t) (byte & ~VARINT_CONTINUATION) << shift;
+                if ((byte & VARINT_CONTINUATION) == 0) {
+                    return value;
+                }
+            }
+            throw std::invalid_argument("Incorrect varint from server");
+        }
+
+        // Returns a varint that has to fit in type T.
+        template <typename T>
+        T get_number() {
+            uint64_t value = get_varint();
+            if (value > std::numeric_limits<T>::max()) {
+                throw std::invalid_argument("Incorrect number from server");
+            }
+            return (T) value;
+        }
+
+        uint8_t get_byte() {
+            if (data == end) {
+                set_incomplete(1);
+                return 0;
+            }
+            return (uint8_t) *data++;
+        }
+
+        void skip(uint64_t count) {
+            if (count > (uint64_t) (end - data)) {
+                set_incomplete((size_t) (count - (uint64_t) (end - data)));
+                data = end;
+                return;
+            }
+            data += count;
+        }
+
+        // Reads the length of a list of elements, each of at least one byte.
+        uint64_t get_list_length() {
+            uint64_t length = get_varint();
+            if (length > (uint64_t) (end - data)) {
+                set_incomplete((size_t) (length - (uint64_t) (end - data)));
+                return 0;
+            }
+            return length;
+        }
+
+        // Reads a delta-encoded position following 'previous'.
+        Position get_position(Position previous) {
+            auto x = get_number<coordinate_t>();
+            if (x == 0) {
+                auto y = get_number<coordinate_t>();
+                return {previous.get_x(), (coordinate_t) (previous.get_y() + y)};
+            }
+            return {(coordinate_t) (previous.get_x() + x), get_number<coordinate_t>()};
+        }
+
+        Position get_absolute_position() {
+            auto x = get_number<coordinate_t>();
+            return {x, get_number<coordinate_t>()};
+        }
+    };
+
+    // Reads a CompactTurn message (without the message id) calling 'on_explosion' for every
+    // bomb exploded (with the reader placed at its robots destroyed list), and 'on_event' for
+    // every other event. Stops early if message is incomplete.
+    template <typename OnExplosion, typename OnEvent>
+    void read_turn(Reader &reader, turn_t &turn, OnExplosion &&on_explosion, OnEvent &&on_event) {
+        turn = reader.get_number<turn_t>();
+        bomb_id_t bomb_id = 0;
+        uint64_t exploded_size = reader.get_list_length();
+        for (uint64_t i = 0; i < exploded_size && !reader.incomplete; i++) {
+            bomb_id += reader.get_number<bomb_id_t>();
+            on_explosion(bomb_id);
+        }
+        bomb_id = 0;
+        uint64_t placed_size = reader.get_list_length();
+        for (uint64_t i = 0; i < placed_size && !reader.incomplete; i++) {
+            bomb_id += reader.get_number<bomb_id_t>();
+            on_event(BombPlaced(bomb_id, reader.get_absolute_position()));
+        }
+        uint64_t moved_size = reader.get_list_length();
+        for (uint64_t i = 0; i < moved_size && !reader.incomplete; i++) {
+            player_id_t player_id = reader.get_byte();
+            on_event(PlayerMoved(player_id, reader.get_absolute_position()));
+        }
+        Position position(0, 0);
+        uint64_t blocks_placed_size = reader.get_list_length();
+        for (uint64_t i = 0; i < blocks_placed_size && !reader.incomplete; i++) {
+            position = reader.get_position(position);
+            on_event(BlockPlaced(position));
+        }
+    }
+
+    // Parts of a CompactTurn message measured one by one, each resumed when incomplete.
+    enum MeasureStage : unsigned {
+        TURN,
+        EXPLODED_SIZE,
+        EXPLODED, // Bomb id, robots destroyed and the length of blocks destroyed.
+        EXPLODED_BLOCKS,
+        PLACED_SIZE,
+        PLACED,
+        MOVED_SIZE,
+        MOVED,
+        BLOCKS_PLACED_SIZE,
+        BLOCKS_PLACED,
+        MEASURED
+    };
+
+    // Reads lists of robots and blocks destroyed by an explosion, calling 'on_robot' and
+    // 'on_block' for their elements.
+    template <typename OnRobot, typename OnBlock>
+    void read_destroyed(Reader &reader, OnRobot &&on_robot, OnBlock &&on_block) {
+        uint64_t robots_size = reader.get_list_length();
+        for (uint64_t i = 0; i < robots_size && !reader.incomplete; i++) {
+            on_robot(reader.get_byte());
+        }
+        Position position(0, 0);
+        uint64_t blocks_size = reader.get_list_length();
+        for (uint64_t i = 0; i < blocks_size && !reader.incomplete; i++) {
+            position = reader.get_position(position);
+            on_block(position);
+        }
+    }
+}
+
+bool CompactTurn::insert_to_buffer(Buffer &buffer, const TurnView &turn) {
+    // Events grouped by type are kept between calls, so that they aren't allocated every time.
+    thread_local std::vector<EventView> bombs_exploded;
+    thread_local std::vector<EventView> bombs_placed;
+    thread_local std::vector<EventView> players_moved;
+    thread_local std::vector<Position> blocks_placed;
+    thread_local std::vector<Position> blocks_destroyed;
+    bombs_exploded.clear();
+    bombs_placed.clear();
+    players_moved.clear();
+    blocks_placed.clear();
+    for (EventView event: turn) {
+        switch (event.get_type()) {
+            case EventType::BombExploded:
+                if (!bombs_placed.empty() || !players_moved.empty() || !blocks_placed.empty()) {
+                    // An explosion after other events.
+                    return false;
+                }
+                bombs_exploded.push_back(event);
+                break;
+            case EventType::BombPlaced:
+                bombs_placed.push_back(event);
+                break;
+            case EventType::PlayerMoved:
+                players_moved.push_back(event);
+                break;
+            case EventType::BlockPlaced:
+                blocks_placed.push_back(event.get_position());
+                break;
+        }
+    }
+    auto by_bomb_id = [](const EventView &a, const EventView &b) {
+        return a.get_bomb_id() < b.get_bomb_id();
+    };
+    std::stable_sort(bombs_exploded.begin(), bombs_exploded.end(), by_bomb_id);
+    std::stable_sort(bombs_placed.begin(), bombs_placed.end(), by_bomb_id);
+    std::stable_sort(players_moved.begin(), players_moved.end(),
+                     [](const EventView &a, const EventView &b) {
+                         return a.get_player_id() < b.get_player_id();
+                     });
+
+    MessageIdLayout::insert(buffer, static_cast<message_id_t>(ServerMessageType::CompactTurn));
+    insert_varint(buffer, turn.get_turn());
+
+    bomb_id_t bomb_id = 0;
+    insert_varint(buffer, bombs_exploded.size());
+    for (EventView bomb_exploded: bombs_exploded) {
+        insert_varint(buffer, bomb_exploded.get_bomb_id() - bomb_id);
+        bomb_id = bomb_exploded.get_bomb_id();
+        insert_varint(buffer, bomb_exploded.get_robots_destroyed().size());
+        for (player_id_t robot_destroyed: bomb_exploded.get_robots_destroyed()) {
+            PlayerIdLayout::insert(buffer, robot_destroyed);
+        }
+        blocks_destroyed.clear();
+        for (Position block_destroyed: bomb_exploded.get_blocks_destroyed()) {
+            blocks_destroyed.push_back(block_destroyed);
+        }
+        insert_positions(buffer, blocks_destroyed);
+    }
+
+    bomb_id = 0;
+    insert_varint(buffer, bombs_placed.size());
+    for (EventView bomb_placed: bombs_placed) {
+        insert_varint(buffer, bomb_placed.get_bomb_id() - bomb_id);
+        bomb_id = bomb_placed.get_bomb_id();
+        insert_varint(buffer, bomb_placed.get_position().get_x());
+        insert_varint(buffer, bomb_placed.get_position().get_y());
+    }
+
+    insert_varint(buffer, players_moved.size());
+    for (EventView player_moved: players_moved) {
+        PlayerIdLayout::insert(buffer, player_moved.get_player_id());
+        insert_varint(buffer, player_moved.get_position().get_x());
+        insert_varint(buffer, player_moved.get_position().get_y());
+    }
+
+    insert_positions(buffer, blocks_placed);
+    return true;
+}
+
+size_t CompactTurn::measure(const char *data, size_t available, MeasureProgress &progress) {
+    // Every step measures a single number or element. Only a complete one is added to progress,
+    // so an incomplete one is measured again (from its beginning) when more bytes arrive.
+    while (progress.stage != MEASURED) {
+        const char *part = data + progress.length;
+        Reader reader(part, available - progress.length);
+        unsigned stage = progress.stage;
+        uint64_t left = progress.left;
+        uint64_t nested_left = progress.nested_left;
+        switch (stage) {
+            case TURN:
+                reader.get_number<turn_t>();
+                stage = EXPLODED_SIZE;
+                break;
+            case EXPLODED_SIZE:
+            case PLACED_SIZE:
+            case MOVED_SIZE:
+            case BLOCKS_PLACED_SIZE:
+                left = reader.get_varint();
+                stage++;
+                break;
+            case EXPLODED:
+                if (left == 0) {
+                    stage = PLACED_SIZE;
+                    break;
+                }
+                reader.get_number<bomb_id_t>();
+                reader.skip(reader.get_varint());
+                nested_left = reader.get_varint();
+                stage = EXPLODED_BLOCKS;
+                break;
+            case EXPLODED_BLOCKS:
+                if (nested_left == 0) {
+                    left--;
+                    stage = EXPLODED;
+                    break;
+                }
+                reader.get_position(Position(0, 0));
+                nested_left--;
+                break;
+            case PLACED:
+                if (left == 0) {
+                    stage = MOVED_SIZE;
+                    break;
+                }
+                reader.get_number<bomb_id_t>();
+                reader.get_absolute_position();
+                left--;
+                break;
+            case MOVED:
+                if (left == 0) {
+                    stage = BLOCKS_PLACED_SIZE;
+                    break;
+                }
+                reader.get_byte();
+                reader.get_absolute_position();
+                left--;
+                break;
+            default: // BLOCKS_PLACED
+                if (left == 0) {
+                    stage = MEASURED;
+                    break;
+                }
+                reader.get_position(Position(0, 0));
+                left--;
+                break;
+        }
+        if (reader.incomplete) {
+            progress.needed = progress.length + reader.get_read_length(part) +
+                              reader.missing_length;
+            return 0;
+        }
+        progress.length += reader.get_read_length(part);
+        progress.stage = stage;
+        progress.left = left;
+        progress.nested_left = nested_left;
+    }
+    return progress.length;
+}
+
+void CompactTurn::apply(const char *data, size_t length, GameState &game_state) {
+    // Clear explosions set.
+    game_state.explosions.clear();
+
+    Reader reader(data, length);
+    std::bitset<PLAYERS_COUNT_MAX + 1> robots_destroyed;
+    read_turn(reader, game_state.turn, [&](bomb_id_t bomb_id) {
+        BombExploded::calculate_explosion(bomb_id, game_state);
+        // Remove the bomb.
+        game_state.bombs.erase(bomb_id);
+        read_destroyed(reader, [&](player_id_t robot_destroyed) {
+            robots_destroyed.set(robot_destroyed);
+        }, [](Position) {});
+    }, [&](auto event) {
+        event.execute(game_state);
+    });
+
+    // Remove blocks destroyed in this turn (only after all events, as in a Turn message).
+    Reader destroyed_reader(data, length);
+    turn_t turn;
+    read_turn(destroyed_reader, turn, [&](bomb_id_t) {
+        read_destroyed(destroyed_reader, [](player_id_t) {}, [&](Position block_destroyed) {
+            game_state.blocks.erase(block_destroyed);
+        });
+    }, [](auto const &) {});
+
+    // Give a point to every player who died in this turn.
+    for (size_t player_id = 0; player_id < robots_destroyed.size(); player_id++) {
+        if (robots_destroyed.test(player_id)) {
+            game_state.scores[(player_id_t) player_id]++;
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef COMPACT_H
+#define COMPACT_H
+
+#include "turn_view.h"
+
+// Compact encoding of Turn messages, sent (as CompactTurn messages) only to clients that opted
+// in to it. Numbers are varints (7 bits per byte, least significant first, the highest bit set
+// in all bytes but the last one). Events are grouped in runs of one type, each run being its
+// length followed by the events:
+//   turn,
+//   BombExploded run: bomb id (delta from the previous one), robots destroyed (length, then
+//                     1-byte ids), blocks destroyed (positions list, see below),
+//   BombPlaced run:   bomb id (delta from the previous one), x, y,
+//   PlayerMoved run:  1-byte player id, x, y,
+//   BlockPlaced run:  positions list.
+// Lists of positions are sorted and delta-encoded: for every position the difference of x
+// coordinates, then the difference of y coordinates if x is the same, the y coordinate
+// otherwise. Runs are sorted too. Applying the events in this order gives the same state of the
+// game as the order of a Turn message, as long as all explosions precede the other events
+// (which is how the server emits them). Turns emitted in another order can't be encoded.
+class CompactTurn {
+public:
+    // Inserts a turn (re-encoding a Turn message) into buffer (with the message id). Returns
+    // false (and doesn't insert anything) if the turn can't be encoded.
+    static bool insert_to_buffer(Buffer &buffer, const TurnView &turn);
+
+    // Returns the length of a CompactTurn message (without the message id) starting at 'data'
+    // if all of it is among 'available' bytes, 0 otherwise (resuming from 'progress', see
+    // Buffer).
+    static size_t measure(const char *data, size_t available, MeasureProgress &progress);
+
+    // Updates 'game_state' with the events of the turn kept in 'length' bytes at 'data'.
+    static void apply(const char *data, size_t length, GameState &game_state);
+};
+
+#endif //COMPACT_H
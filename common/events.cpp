@@ -1,47 +1,31 @@
 #include "events.h"
 
-// Gets a BombPlaced event from buffer.
-BombPlaced::BombPlaced(Buffer &buffer) {
-    buffer.get(id, BOMB_ID_SIZE);
-    Position position_copy(buffer);
-    position = position_copy;
-}
-
-// Executes the BombPlaced event and updates 'game_state' and 'destroyed_players' and
-// 'destroyed_blocks' sets accordingly.
-void BombPlaced::execute(GameState &game_state) {
+// Executes the BombPlaced event and updates 'game_state' accordingly.
+void BombPlaced::execute(GameState &game_state) const {
     // Insert a new bomb.
-    game_state.bombs[id] = Bomb(position, game_state.bomb_timer);
+    game_state.bombs.insert(id, Bomb(position, (explosion_turn_t) game_state.turn +
+                                               game_state.bomb_timer));
 }
 
-void BombPlaced::insert_to_buffer([[maybe_unused]] Buffer &buffer) const {
-    auto event_type = static_cast<message_id_t>(type);
-    buffer.insert(event_type, EVENT_TYPE_SIZE);
-    buffer.insert(id, BOMB_ID_SIZE);
-    position.insert_to_buffer(buffer);
+void BombPlaced::insert_to_buffer(Buffer &buffer) const {
+    auto event_type = static_cast<event_type_t>(EventType::BombPlaced);
+    WithEventType<BombPlacedLayout>::insert(buffer, event_type, id, position.get_x(),
+                                            position.get_y());
 }
 
-// Gets a BombExploded event from buffer.
-BombExploded::BombExploded(Buffer &buffer) {
-    buffer.get(id, BOMB_ID_SIZE);
-
-    list_length_t robots_destroyed_size;
-    buffer.get(robots_destroyed_size, LIST_LENGTH_SIZE);
-    for (list_length_t i = 0; i < robots_destroyed_size; i++) {
-        player_id_t player_id;
-        buffer.get(player_id, PLAYER_ID_SIZE);
-        robots_destroyed.insert(player_id);
-    }
-
-    list_length_t blocks_destroyed_size;
-    buffer.get(blocks_destroyed_size, LIST_LENGTH_SIZE);
-    for (list_length_t i = 0; i < blocks_destroyed_size; i++) {
-        Position position(buffer);
-        blocks_destroyed.insert(position);
+void BombExploded::calculate_explosion(bomb_id_t id, const GameState &game_state,
+                                       PositionSet &explosions) {
+    if (game_state.blocks.get_extents().is_enabled()) {
+        calculate_explosion_extents(id, game_state, explosions);
+    } else if (game_state.blocks.get_bitboard().is_enabled()) {
+        calculate_explosion_bitboard(id, game_state, explosions);
+    } else {
+        calculate_explosion_reference(id, game_state, explosions);
     }
 }
 
-void BombExploded::calculate_explosion(GameState &game_state) const {
+void BombExploded::calculate_explosion_reference(bomb_id_t id, const GameState &game_state,
+                                                 PositionSet &explosions) {
     Position bomb_position(game_state.bombs[id].get_position());
     coordinate_t bomb_position_x = bomb_position.get_x();
     coordinate_t bomb_position_y = bomb_position.get_y();
@@ -50,7 +34,7 @@ void BombExploded::calculate_explosion(GameState &game_state) const {
     int left = std::max((int) bomb_position_x - (int) game_state.explosion_radius, 0);
     for (int x = (int) bomb_position_x; x >= left; x--) {
         Position explosion((coordinate_t) x, bomb_position_y);
-        game_state.explosions.insert(explosion);
+        explosions.insert(explosion);
         // Exit the loop when we reached a position containing a block.
         if (game_state.blocks.contains(explosion)) {
             break;
@@ -62,7 +46,7 @@ void BombExploded::calculate_explosion(GameState &game_state) const {
                          (int) (game_state.size_x - 1));
     for (int x = bomb_position_x; x <= right; x++) {
         Position explosion((coordinate_t) x, bomb_position_y);
-        game_state.explosions.insert(explosion);
+        explosions.insert(explosion);
         // Exit the loop when we reached a position containing a block.
         if (game_state.blocks.contains(explosion)) {
             break;
@@ -73,7 +57,7 @@ void BombExploded::calculate_explosion(GameState &game_state) const {
     int bottom = std::max((int) bomb_position_y - (int) game_state.explosion_radius, 0);
     for (int y = bomb_position_y; y >= bottom; y--) {
         Position explosion(bomb_position_x, (coordinate_t) y);
-        game_state.explosions.insert(explosion);
+        explosions.insert(explosion);
         // Exit the loop when we reached a position containing a block.
         if (game_state.blocks.contains(explosion)) {
             break;
@@ -85,7 +69,7 @@ void BombExploded::calculate_explosion(GameState &game_state) const {
                        (int) (game_state.size_y - 1));
     for (int y = bomb_position_y; y <= top; y++) {
         Position explosion(bomb_position_x, (coordinate_t) y);
-        game_state.explosions.insert(explosion);
+        explosions.insert(explosion);
         // Exit the loop when we reached a position containing a block.
         if (game_state.blocks.contains(explosion)) {
             break;
@@ -93,105 +77,172 @@ void BombExploded::calculate_explosion(GameState &game_state) const {
     }
 }
 
-void BombExploded::calculate_robots_destroyed(GameState &game_state) {
-    for (auto & [player_id, position]: game_state.player_positions) {
-        if (game_state.explosions.contains(position)) {
-            robots_destroyed.insert(player_id);
-        }
+void BombExploded::calculate_explosion_bitboard(bomb_id_t id, const GameState &game_state,
+                                                PositionSet &explosions) {
+    Position bomb_position(game_state.bombs[id].get_position());
+    coordinate_t bomb_position_x = bomb_position.get_x();
+    coordinate_t bomb_position_y = bomb_position.get_y();
+    if (bomb_position_x >= game_state.size_x || bomb_position_y >= game_state.size_y) {
+        throw std::invalid_argument("Position outside of the board");
     }
-}
-
-void BombExploded::calculate_blocks_destroyed(GameState &game_state) {
-    for (auto & position: game_state.blocks) {
-        if (game_state.explosions.contains(position)) {
-            blocks_destroyed.insert(position);
-        }
+    size_t radius = game_state.explosion_radius;
+    const BlockBitboard &bitboard = game_state.blocks.get_bitboard();
+
+    // Every ray ends at the first block in its direction (reached by the explosion) or after
+    // 'radius' fields.
+    const uint64_t *row = bitboard.get_row(bomb_position_y);
+    size_t left = bomb_position_x - std::min((size_t) bomb_position_x, radius);
+    size_t block = find_last_set(row, left, bomb_position_x);
+    if (block != NO_BIT) {
+        left = block;
+    }
+    size_t right = std::min(bomb_position_x + radius, (size_t) game_state.size_x - 1);
+    block = find_first_set(row, bomb_position_x, right);
+    if (block != NO_BIT) {
+        right = block;
     }
-}
 
-// Insert robots and blocks destroyed by this explosion to 'destroyed_players' and
-// 'destroyed_blocks' sets.
-void BombExploded::update_destroyed_robots_and_blocks(std::set<player_id_t> &destroyed_robots,
-                                                      std::set<Position> &destroyed_blocks) {
-    for (auto const & robot_destroyed : robots_destroyed) {
-        destroyed_robots.insert(robot_destroyed);
+    const uint64_t *column = bitboard.get_column(bomb_position_x);
+    size_t bottom = bomb_position_y - std::min((size_t) bomb_position_y, radius);
+    block = find_last_set(column, bottom, bomb_position_y);
+    if (block != NO_BIT) {
+        bottom = block;
     }
-    for (auto const & block_destroyed : blocks_destroyed) {
-        destroyed_blocks.insert(block_destroyed);
+    size_t top = std::min(bomb_position_y + radius, (size_t) game_state.size_y - 1);
+    block = find_first_set(column, bomb_position_y, top);
+    if (block != NO_BIT) {
+        top = block;
     }
 
-};
-
-BombExploded::BombExploded(bomb_id_t id, GameState &game_state,
-                           std::set<player_id_t> &destroyed_robots,
-                           std::set<Position> &destroyed_blocks) :
-        Event(EventType::BombExploded), id(id) {
-    calculate_explosion(game_state);
-    calculate_robots_destroyed(game_state);
-    calculate_blocks_destroyed(game_state);
-    update_destroyed_robots_and_blocks(destroyed_robots, destroyed_blocks);
+    insert_explosion(explosions, bomb_position_x, bomb_position_y, left, right, bottom, top);
 }
 
-// Executes the BombExploded event and updates 'game_state' and 'destroyed_players' and
-// 'destroyed_blocks' sets accordingly.
-void BombExploded::execute(GameState &game_state, std::set<player_id_t> &destroyed_robots,
-                           std::set<Position> &destroyed_blocks) {
-    calculate_explosion(game_state);
-    update_destroyed_robots_and_blocks(destroyed_robots, destroyed_blocks);
-    // Remove the bomb.
-    game_state.bombs.erase(id);
+void BombExploded::calculate_explosion_extents(bomb_id_t id, const GameState &game_state,
+                                               PositionSet &explosions) {
+    Position bomb_position(game_state.bombs[id].get_position());
+    coordinate_t x = bomb_position.get_x();
+    coordinate_t y = bomb_position.get_y();
+    if (x >= game_state.size_x || y >= game_state.size_y) {
+        throw std::invalid_argument("Position outside of the board");
+    }
+    size_t radius = game_state.explosion_radius;
+    const BlastExtents &extents = game_state.blocks.get_extents();
+
+    // Every ray ends after the smaller of the radius and the distance to the nearest block (or
+    // the edge of the board).
+    insert_explosion(explosions, x, y, x - std::min(radius, (size_t) extents.get_left(x, y)),
+                     x + std::min(radius, (size_t) extents.get_right(x, y)),
+                     y - std::min(radius, (size_t) extents.get_down(x, y)),
+                     y + std::min(radius, (size_t) extents.get_up(x, y)));
 }
 
-void BombExploded::insert_to_buffer([[maybe_unused]] Buffer &buffer) const {
-    auto event_type = static_cast<message_id_t>(type);
-    buffer.insert(event_type, EVENT_TYPE_SIZE);
-    buffer.insert(id, BOMB_ID_SIZE);
-    buffer.insert((list_length_t) robots_destroyed.size(), LIST_LENGTH_SIZE);
-    for (auto const & robot_destroyed : robots_destroyed) {
-        buffer.insert(robot_destroyed, PLAYER_ID_SIZE);
-    }
-    buffer.insert((list_length_t) blocks_destroyed.size(), LIST_LENGTH_SIZE);
-    for (auto const & block_destroyed : blocks_destroyed) {
-        block_destroyed.insert_to_buffer(buffer);
+void BombExploded::insert_explosion(PositionSet &explosions, coordinate_t x, coordinate_t y,
+                                    size_t left, size_t right, size_t bottom, size_t top) {
+    // Fields of the column are consecutive bits of 'explosions', inserted a word at a time.
+    explosions.insert_column(x, (coordinate_t) bottom, (coordinate_t) top);
+    for (size_t field_x = left; field_x <= right; field_x++) {
+        explosions.insert(Position((coordinate_t) field_x, y));
     }
 }
 
-// Gets a PlayerMoved event from buffer.
-PlayerMoved::PlayerMoved(Buffer &buffer) {
-    buffer.get(id, PLAYER_ID_SIZE);
-    Position position_copy(buffer);
-    position = position_copy;
+void BombExploded::insert_to_buffer(Buffer &buffer,
+                                    std::span<const player_id_t> robots_destroyed,
+                                    std::span<const Position> blocks_destroyed) const {
+    auto event_type = static_cast<event_type_t>(EventType::BombExploded);
+    WithEventType<BombExplodedLayout>::insert(buffer, event_type, id,
+                                              (list_length_t) robots_destroyed.size());
+    char *data = buffer.reserve(robots_destroyed.size() * PlayerIdLayout::size);
+    for (player_id_t robot_destroyed : robots_destroyed) {
+        store(data++, robot_destroyed);
+    }
+    Position::insert_list_to_buffer(buffer, blocks_destroyed);
 }
 
-// Executes the PlayerMoved event and updates 'game_state' and 'destroyed_players' and
-// 'destroyed_blocks' sets accordingly.
-void PlayerMoved::execute(GameState &game_state) {
+// Executes the PlayerMoved event and updates 'game_state' accordingly.
+void PlayerMoved::execute(GameState &game_state) const {
     // Update the player's position.
-    game_state.player_positions[id] = position;
+    game_state.player_positions.move(id, position);
 }
 
 void PlayerMoved::insert_to_buffer(Buffer &buffer) const {
-    auto event_type = static_cast<message_id_t>(type);
-    buffer.insert(event_type, EVENT_TYPE_SIZE);
-    buffer.insert(id, PLAYER_ID_SIZE);
-    position.insert_to_buffer(buffer);
-}
-
-// Gets a BlockPlaced event from buffer.
-BlockPlaced::BlockPlaced(Buffer &buffer) {
-    Position position_copy(buffer);
-    position = position_copy;
+    auto event_type = static_cast<event_type_t>(EventType::PlayerMoved);
+    WithEventType<PlayerMovedLayout>::insert(buffer, event_type, id, position.get_x(),
+                                             position.get_y());
 }
 
-// Executes the BlockPlaced event and updates 'game_state' and 'destroyed_players' and
-// 'destroyed_blocks' sets accordingly.
-void BlockPlaced::execute(GameState &game_state) {
+// Executes the BlockPlaced event and updates 'game_state' accordingly.
+void BlockPlaced::execute(GameState &game_state) const {
     // Add a block.
     game_state.blocks.insert(position);
 }
 
 void BlockPlaced::insert_to_buffer(Buffer &buffer) const {
-    auto event_type = static_cast<message_id_t>(type);
-    buffer.insert(event_type, EVENT_TYPE_SIZE);
-    position.insert_to_buffer(buffer);
-}
\ No newline at end of file
+    auto event_type = static_cast<event_type_t>(EventType::BlockPlaced);
+    WithEventType<BlockPlacedLayout>::insert(buffer, event_type, position.get_x(),
+                                             position.get_y());
+}
+
+void TurnEvents::add_bomb_exploded(bomb_id_t id, const GameState &game_state,
+                                   const PositionSet &explosions) {
+    auto robots_begin = (list_length_t) robots_destroyed.size();
+    auto blocks_begin = (list_length_t) blocks_destroyed.size();
+    // Fields of the explosion are visited in order, so blocks are sorted (robots aren't).
+    for (Position position: explosions) {
+        game_state.player_positions.for_each_robot_on(position, [this](player_id_t player_id) {
+            robots_destroyed.push_back(player_id);
+        });
+        if (game_state.blocks.contains(position)) {
+            blocks_destroyed.push_back(position);
+        }
+    }
+    std::sort(robots_destroyed.begin() + robots_begin, robots_destroyed.end());
+    events.emplace_back(BombExploded(id, robots_begin, (list_length_t) robots_destroyed.size(),
+                                     blocks_begin, (list_length_t) blocks_destroyed.size()));
+}
+
+void TurnEvents::append(const TurnEvents &other) {
+    auto robots_offset = (list_length_t) robots_destroyed.size();
+    auto blocks_offset = (list_length_t) blocks_destroyed.size();
+    for (auto const & event: other.events) {
+        if (auto bomb_exploded = std::get_if<BombExploded>(&event)) {
+            events.emplace_back(BombExploded(bomb_exploded->id,
+                                             robots_offset + bomb_exploded->robots_begin,
+                                             robots_offset + bomb_exploded->robots_end,
+                                             blocks_offset + bomb_exploded->blocks_begin,
+                                             blocks_offset + bomb_exploded->blocks_end));
+        } else {
+            events.push_back(event);
+        }
+    }
+    robots_destroyed.insert(robots_destroyed.end(), other.robots_destroyed.begin(),
+                            other.robots_destroyed.end());
+    blocks_destroyed.insert(blocks_destroyed.end(), other.blocks_destroyed.begin(),
+                            other.blocks_destroyed.end());
+}
+
+void TurnEvents::insert_to_buffer(Buffer &buffer) const {
+    for (auto const & event: events) {
+        std::visit([this, &buffer](auto const & any_event) {
+            if constexpr (std::is_same_v<std::decay_t<decltype(any_event)>, BombExploded>) {
+                any_event.insert_to_buffer(buffer, get_robots_destroyed(any_event),
+                                           get_blocks_destroyed(any_event));
+            } else {
+                any_event.insert_to_buffer(buffer);
+            }
+        }, event);
+    }
+}
+
+size_t TurnEvents::get_encoded_size() const {
+    size_t encoded_size = 0;
+    for (auto const & event: events) {
+        encoded_size += std::visit([](auto const & any_event) {
+            if constexpr (std::is_same_v<std::decay_t<decltype(any_event)>, BombExploded>) {
+                return any_event.get_encoded_size();
+            } else {
+                return std::decay_t<decltype(any_event)>::ENCODED_SIZE;
+            }
+        }, event);
+    }
+    return encoded_size;
+}
@@ -1,6 +1,10 @@
 #ifndef EVENTS_H
 #define EVENTS_H
 
+#include <memory_resource>
+#include <span>
+#include <variant>
+#include "arena.h"
 #include "game.h"
 
 enum class EventType : event_type_t {
@@ -10,77 +14,216 @@ enum class EventType : event_type_t {
     BlockPlaced = 3,
 };
 
-class Event {
-protected:
-    EventType type{};
-public:
-    Event() = default;
-    explicit Event(EventType type) : type(type) {}
-    virtual ~Event() = default;
-    virtual void execute([[maybe_unused]] GameState &game_state) {}
-    virtual void execute([[maybe_unused]] GameState &game_state,
-                         [[maybe_unused]] std::set<player_id_t> &destroyed_players,
-                         [[maybe_unused]] std::set<Position> &destroyed_blocks) {}
-    virtual void insert_to_buffer([[maybe_unused]] Buffer &buffer) const {}
-};
-
-class BombPlaced : public Event {
+class BombPlaced {
 private:
     bomb_id_t id{};
     Position position{};
 
 public:
-    explicit BombPlaced(Buffer &buffer);
-    explicit BombPlaced(bomb_id_t id, Position position)
-            : Event(EventType::BombPlaced), id(id), position(position) {}
-    void execute(GameState &game_state) override;
-    void insert_to_buffer([[maybe_unused]] Buffer &buffer) const override;
+    static constexpr size_t ENCODED_SIZE = EVENT_TYPE_SIZE + BombPlacedLayout::size;
+
+    explicit BombPlaced(bomb_id_t id, Position position) : id(id), position(position) {}
+    void execute(GameState &game_state) const;
+    void insert_to_buffer(Buffer &buffer) const;
+    [[nodiscard]] bomb_id_t get_id() const {
+        return id;
+    }
+    [[nodiscard]] Position get_position() const {
+        return position;
+    }
 };
 
-class BombExploded : public Event {
+// Robots and blocks destroyed by a BombExploded event are kept by TurnEvents, shared by all
+// explosions of the turn; the event keeps their ranges.
+class BombExploded {
 private:
     bomb_id_t id{};
-    std::set<player_id_t> robots_destroyed;
-    std::set<Position> blocks_destroyed;
+    list_length_t robots_begin{};
+    list_length_t robots_end{};
+    list_length_t blocks_begin{};
+    list_length_t blocks_end{};
 
-    void calculate_explosion(GameState &game_state) const;
-    void calculate_robots_destroyed(GameState &game_state);
-    void calculate_blocks_destroyed(GameState &game_state);
-    void update_destroyed_robots_and_blocks(std::set<player_id_t> &destroyed_robots,
-                                            std::set<Position> &destroyed_blocks);
+    // Inserts fields of the explosion of a bomb at (x, y) reaching given coordinates in each
+    // direction into 'explosions'.
+    static void insert_explosion(PositionSet &explosions, coordinate_t x, coordinate_t y,
+                                 size_t left, size_t right, size_t bottom, size_t top);
 
 public:
-    explicit BombExploded(Buffer &buffer);
-    explicit BombExploded(bomb_id_t id, GameState &game_state,
-                          std::set<player_id_t> &destroyed_robots,
-                          std::set<Position> &destroyed_blocks);
-    void execute(GameState &game_state, std::set<player_id_t> &destroyed_robots,
-                 std::set<Position> &destroyed_blocks) override;
-    void insert_to_buffer([[maybe_unused]] Buffer &buffer) const override;
+    BombExploded(bomb_id_t id, list_length_t robots_begin, list_length_t robots_end,
+                 list_length_t blocks_begin, list_length_t blocks_end) :
+            id(id), robots_begin(robots_begin), robots_end(robots_end),
+            blocks_begin(blocks_begin), blocks_end(blocks_end) {}
+    // Inserts fields reached by the explosion of bomb 'id' into 'game_state.explosions' (using
+    // blast extents or the bitboard of blocks if there are any).
+    static void calculate_explosion(bomb_id_t id, GameState &game_state) {
+        calculate_explosion(id, game_state, game_state.explosions);
+    }
+    // Inserts fields reached by the explosion into 'explosions' instead. It only reads
+    // 'game_state', so explosions of many bombs can be calculated at once.
+    static void calculate_explosion(bomb_id_t id, const GameState &game_state,
+                                    PositionSet &explosions);
+    // Calculates the explosion field by field.
+    static void calculate_explosion_reference(bomb_id_t id, const GameState &game_state,
+                                              PositionSet &explosions);
+    // Calculates the explosion using the bitboard of blocks (which has to be enabled).
+    static void calculate_explosion_bitboard(bomb_id_t id, const GameState &game_state,
+                                             PositionSet &explosions);
+    // Calculates the explosion using blast extents of blocks (which have to be enabled).
+    static void calculate_explosion_extents(bomb_id_t id, const GameState &game_state,
+                                            PositionSet &explosions);
+    void insert_to_buffer(Buffer &buffer, std::span<const player_id_t> robots_destroyed,
+                          std::span<const Position> blocks_destroyed) const;
+    [[nodiscard]] size_t get_encoded_size() const {
+        return EVENT_TYPE_SIZE + BombExplodedLayout::size +
+               (size_t) (robots_end - robots_begin) * PlayerIdLayout::size + LIST_LENGTH_SIZE +
+               (size_t) (blocks_end - blocks_begin) * PositionLayout::size;
+    }
+    [[nodiscard]] bomb_id_t get_id() const {
+        return id;
+    }
+
+    friend class TurnEvents;
 };
 
-class PlayerMoved : public Event {
+class PlayerMoved {
 private:
     player_id_t id{};
     Position position{};
 
 public:
-    explicit PlayerMoved(Buffer &buffer);
-    PlayerMoved(player_id_t id, Position position) :
-            Event(EventType::PlayerMoved), id(id), position(position) {}
-    void execute(GameState &game_state) override;
-    void insert_to_buffer(Buffer &buffer) const override;
+    static constexpr size_t ENCODED_SIZE = EVENT_TYPE_SIZE + PlayerMovedLayout::size;
+
+    PlayerMoved(player_id_t id, Position position) : id(id), position(position) {}
+    void execute(GameState &game_state) const;
+    void insert_to_buffer(Buffer &buffer) const;
+    [[nodiscard]] player_id_t get_id() const {
+        return id;
+    }
+    [[nodiscard]] Position get_position() const {
+        return position;
+    }
 };
 
-class BlockPlaced : public Event {
+class BlockPlaced {
 private:
     Position position{};
 
 public:
-    explicit BlockPlaced(Buffer &buffer);
-    explicit BlockPlaced(Position position) : Event(EventType::BlockPlaced), position(position) {}
-    void execute(GameState &game_state) override;
-    void insert_to_buffer(Buffer &buffer) const override;
+    static constexpr size_t ENCODED_SIZE = EVENT_TYPE_SIZE + BlockPlacedLayout::size;
+
+    explicit BlockPlaced(Position position) : position(position) {}
+    void execute(GameState &game_state) const;
+    void insert_to_buffer(Buffer &buffer) const;
+    [[nodiscard]] Position get_position() const {
+        return position;
+    }
+};
+
+// Event kept by value. Alternatives are in the order of event types.
+using Event = std::variant<BombPlaced, BombExploded, PlayerMoved, BlockPlaced>;
+
+static_assert(std::is_same_v<std::variant_alternative_t<(size_t) EventType::BombPlaced, Event>,
+                             BombPlaced> &&
+              std::is_same_v<std::variant_alternative_t<(size_t) EventType::BombExploded, Event>,
+                             BombExploded> &&
+              std::is_same_v<std::variant_alternative_t<(size_t) EventType::PlayerMoved, Event>,
+                             PlayerMoved> &&
+              std::is_same_v<std::variant_alternative_t<(size_t) EventType::BlockPlaced, Event>,
+                             BlockPlaced>);
+
+inline EventType get_event_type(const Event &event) {
+    return static_cast<EventType>(event.index());
+}
+
+// Events of a turn, kept by value in a single vector, in the order they happened. Robots and
+// blocks destroyed by all explosions of the turn are kept in two vectors too. The vectors take
+// memory from an arena, which is reset when the events are cleared for the next turn, so once
+// the arena has grown to the size of a busy turn, a turn doesn't allocate memory.
+class TurnEvents {
+private:
+    TurnArena arena;
+    std::pmr::vector<Event> events{&arena};
+    std::pmr::vector<player_id_t> robots_destroyed{&arena};
+    std::pmr::vector<Position> blocks_destroyed{&arena};
+
+public:
+    TurnEvents() = default;
+    TurnEvents(const TurnEvents &) = delete;
+    TurnEvents &operator=(const TurnEvents &) = delete;
+
+    void clear() {
+        // Memory of the vectors is given back to the arena (which ignores it) before the reset.
+        events = std::pmr::vector<Event>(&arena);
+        robots_destroyed = std::pmr::vector<player_id_t>(&arena);
+        blocks_destroyed = std::pmr::vector<Position>(&arena);
+        arena.reset();
+    }
+
+    void add_bomb_placed(bomb_id_t id, Position position) {
+        events.emplace_back(BombPlaced(id, position));
+    }
+
+    // Calculates the explosion of bomb 'id' (into 'game_state.explosions') and adds a
+    // BombExploded event with robots and blocks destroyed by it.
+    void add_bomb_exploded(bomb_id_t id, GameState &game_state) {
+        BombExploded::calculate_explosion(id, game_state);
+        add_bomb_exploded(id, game_state, game_state.explosions);
+    }
+
+    // Adds a BombExploded event with robots and blocks destroyed by an explosion of bomb 'id'
+    // already calculated into 'explosions'.
+    void add_bomb_exploded(bomb_id_t id, const GameState &game_state,
+                           const PositionSet &explosions);
+
+    // Appends events of 'other' (with robots and blocks destroyed by its explosions).
+    void append(const TurnEvents &other);
+
+    void add_player_moved(player_id_t id, Position position) {
+        events.emplace_back(PlayerMoved(id, position));
+    }
+
+    void add_block_placed(Position position) {
+        events.emplace_back(BlockPlaced(position));
+    }
+
+    // Returns robots destroyed by an explosion of this turn (sorted).
+    [[nodiscard]] std::span<const player_id_t> get_robots_destroyed(
+            const BombExploded &bomb_exploded) const {
+        return {robots_destroyed.data() + bomb_exploded.robots_begin,
+                robots_destroyed.data() + bomb_exploded.robots_end};
+    }
+
+    // Returns blocks destroyed by an explosion of this turn (sorted).
+    [[nodiscard]] std::span<const Position> get_blocks_destroyed(
+            const BombExploded &bomb_exploded) const {
+        return {blocks_destroyed.data() + bomb_exploded.blocks_begin,
+                blocks_destroyed.data() + bomb_exploded.blocks_end};
+    }
+
+    // Returns robots destroyed by all explosions of this turn (a robot can appear many times).
+    [[nodiscard]] std::span<const player_id_t> get_robots_destroyed() const {
+        return robots_destroyed;
+    }
+
+    // Returns blocks destroyed by all explosions of this turn (a block can appear many times).
+    [[nodiscard]] std::span<const Position> get_blocks_destroyed() const {
+        return blocks_destroyed;
+    }
+
+    // Inserts all events (without their number) into buffer.
+    void insert_to_buffer(Buffer &buffer) const;
+    // Returns the number of bytes inserted by 'insert_to_buffer'.
+    [[nodiscard]] size_t get_encoded_size() const;
+
+    [[nodiscard]] size_t size() const {
+        return events.size();
+    }
+    [[nodiscard]] std::pmr::vector<Event>::const_iterator begin() const {
+        return events.begin();
+    }
+    [[nodiscard]] std::pmr::vector<Event>::const_iterator end() const {
+        return events.end();
+    }
 };
 
 #endif //EVENTS_H
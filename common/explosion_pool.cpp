@@ -0,0 +1,25 @@
+#include "explosion_pool.h"
+
+void ExplosionPool::add_bombs_exploded(std::span<const bomb_id_t> ids,
+                                       const GameState &game_state, TurnEvents &events) {
+    size_t parts = ids.size() < MIN_PARALLEL_BOMBS ? 1 : ranges.size();
+    for (size_t part = 0; part < parts; part++) {
+        PositionSet &explosions = ranges[part].explosions;
+        if (explosions.get_size_x() != game_state.size_x ||
+            explosions.get_size_y() != game_state.size_y) {
+            explosions.resize(game_state.size_x, game_state.size_y);
+        }
+    }
+    thread_pool.run(parts, [&](size_t part) {
+        Range &range = ranges[part];
+        range.events.clear();
+        for (size_t i = ids.size() * part / parts; i < ids.size() * (part + 1) / parts; i++) {
+            BombExploded::calculate_explosion(ids[i], game_state, range.explosions);
+            range.events.add_bomb_exploded(ids[i], game_state, range.explosions);
+            range.explosions.clear();
+        }
+    });
+    for (size_t part = 0; part < parts; part++) {
+        events.append(ranges[part].events);
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef EXPLOSION_POOL_H
+#define EXPLOSION_POOL_H
+
+#include <span>
+#include <vector>
+#include "events.h"
+#include "thread_pool.h"
+
+// Calculates explosions of bombs exploding in the same turn on many threads. Explosions of a
+// turn are independent of each other (blocks are removed only after all of them), so bombs are
+// split into ranges of consecutive bombs, one for each thread, and every thread collects robots
+// and blocks destroyed by its bombs into its own events. They are appended to events of the turn
+// in the order of the ranges, so the events are the same as when explosions are calculated one
+// by one.
+class ExplosionPool {
+private:
+    // Explosions of fewer bombs are calculated by the calling thread only.
+    static constexpr size_t MIN_PARALLEL_BOMBS = 16;
+
+    struct Range {
+        PositionSet explosions;
+        TurnEvents events;
+    };
+
+    ThreadPool &thread_pool;
+    std::vector<Range> ranges;
+
+public:
+    // Calculates explosions on threads of 'thread_pool'.
+    explicit ExplosionPool(ThreadPool &thread_pool) :
+            thread_pool(thread_pool), ranges(thread_pool.size()) {}
+
+    // Calculates explosions of bombs 'ids' and adds BombExploded events for them (in this order)
+    // to 'events'. 'game_state.explosions' isn't used.
+    void add_bombs_exploded(std::span<const bomb_id_t> ids, const GameState &game_state,
+                            TurnEvents &events);
+};
+
+#endif //EXPLOSION_POOL_H
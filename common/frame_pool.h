@@ -0,0 +1,87 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <mutex>
+#include <vector>
+
+// Pool of memory blocks for encoded messages. Blocks are grouped in classes by their sizes
+// (powers of two) and reused after messages are destroyed, so that in a steady state encoding a
+// message takes one block from the pool, regardless of the length of the message.
+class FramePool {
+private:
+    static constexpr size_t MIN_BLOCK_SIZE_LOG = 6; // Blocks have at least 64 bytes.
+    static constexpr size_t BLOCK_CLASSES = 64;
+
+    std::mutex mutex;
+    std::array<std::vector<char *>, BLOCK_CLASSES> free_blocks;
+
+    FramePool() = default;
+
+public:
+    // The pool is never destroyed, as messages may outlive static objects.
+    static FramePool &get_instance() {
+        static auto *pool = new FramePool();
+        return *pool;
+    }
+
+    // Returns the class of blocks taken for 'length' bytes.
+    static size_t get_block_class(size_t length) {
+        return std::max((size_t) std::bit_width(length > 0 ? length - 1 : 0), MIN_BLOCK_SIZE_LOG);
+    }
+
+    // Returns a block of at least 'length' bytes and stores its class in 'block_class'.
+    char *acquire(size_t length, size_t &block_class) {
+        block_class = get_block_class(length);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::vector<char *> &blocks = free_blocks[block_class];
+            if (!blocks.empty()) {
+                char *block = blocks.back();
+                blocks.pop_back();
+                return block;
+            }
+        }
+        return new char[(size_t) 1 << block_class];
+    }
+
+    // Returns a block (of class 'block_class') to the pool.
+    void release(char *block, size_t block_class) {
+        std::lock_guard<std::mutex> lock(mutex);
+        free_blocks[block_class].push_back(block);
+    }
+};
+
+// Allocator taking memory from FramePool, for objects made for every message (like encoded
+// messages together with control blocks of their shared pointers).
+template <typename T>
+class FramePoolAllocator {
+public:
+    using value_type = T;
+
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                  "Blocks of FramePool are aligned as operator new memory");
+
+    FramePoolAllocator() = default;
+    template <typename U>
+    explicit FramePoolAllocator(const FramePoolAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+        size_t block_class;
+        return reinterpret_cast<T *>(FramePool::get_instance().acquire(n * sizeof(T), block_class));
+    }
+
+    void deallocate(T *pointer, size_t n) {
+        FramePool::get_instance().release(reinterpret_cast<char *>(pointer),
+                                          FramePool::get_block_class(n * sizeof(T)));
+    }
+
+    template <typename U>
+    bool operator==(const FramePoolAllocator<U> &) const {
+        return true;
+    }
+};
+
+#endif //FRAME_POOL_H
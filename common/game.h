@@ -1,10 +1,22 @@
 #ifndef GAME_H
 #define GAME_H
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <iterator>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <ranges>
 #include <set>
+#include <span>
+#include <stdexcept>
 #include <utility>
-#include "buffer.h"
+#include <vector>
+#include "bitboard.h"
+#include "blast_extents.h"
+#include "schema.h"
 
 class Player {
 private:
@@ -24,6 +36,11 @@ public:
         buffer.insert(name);
         buffer.insert(address);
     }
+
+    // Returns the number of bytes inserted by 'insert_to_buffer'.
+    [[nodiscard]] size_t get_encoded_size() const {
+        return 2 * STRING_LENGTH_SIZE + name.length() + address.length();
+    }
 };
 
 class Position {
@@ -34,8 +51,7 @@ private:
 public:
     Position() = default;
     explicit Position(Buffer &buffer) {
-        buffer.get(x, COORDINATE_SIZE);
-        buffer.get(y, COORDINATE_SIZE);
+        PositionLayout::get(buffer, x, y);
     }
     Position(coordinate_t x, coordinate_t y) : x(x), y(y) {}
 
@@ -43,13 +59,35 @@ public:
         return x != that.x ? x < that.x : y < that.y;
     }
 
+    inline bool operator==(const Position &that) const {
+        return x == that.x && y == that.y;
+    }
+
     inline bool operator!=(const Position &that) const {
         return x != that.x || y != that.y;
     }
 
     void insert_to_buffer(Buffer &buffer) const {
-        buffer.insert(x, COORDINATE_SIZE);
-        buffer.insert(y, COORDINATE_SIZE);
+        PositionLayout::insert(buffer, x, y);
+    }
+
+    // Inserts a list of positions (with its length) into buffer at once: with a single bounds
+    // check and with byte order of all coordinates converted in bulk.
+    template <typename Container>
+    static void insert_list_to_buffer(Buffer &buffer, const Container &positions) {
+        auto positions_size = (list_length_t) positions.size();
+        ListLengthLayout::insert(buffer, positions_size);
+        char *data = buffer.reserve(positions_size * PositionLayout::size);
+        if constexpr (std::ranges::contiguous_range<const Container>) {
+            memcpy(data, std::to_address(positions.begin()), positions_size * sizeof(Position));
+        } else {
+            char *element = data;
+            for (Position const & position: positions) {
+                memcpy(element, &position, sizeof(Position));
+                element += sizeof(Position);
+            }
+        }
+        swap_network_byte_order_16(data, 2 * (size_t) positions_size);
     }
 
     [[nodiscard]] coordinate_t get_x() const {
@@ -61,35 +99,720 @@ public:
     }
 };
 
+// Position is kept in memory as its coordinates, in the order of the wire format, so lists of
+// positions can be copied to and from buffer at once.
+static_assert(sizeof(Position) == PositionLayout::size && std::is_standard_layout_v<Position>);
+
+// Set of positions on the board, kept as a bitset of all fields of the board (field (x, y) is
+// bit x * size_y + y, so bits are in the order of positions). Memory for the bitset is
+// allocated in pages when the first position in a page is inserted, so sets of few positions on
+// a large board stay small, and clearing and iterating visit only used pages.
+class PositionSet {
+private:
+    static constexpr size_t WORD_BITS = 64;
+    static constexpr size_t PAGE_WORDS = 64;
+    static constexpr size_t PAGE_BITS = PAGE_WORDS * WORD_BITS;
+
+    struct Page {
+        std::array<uint64_t, PAGE_WORDS> words{};
+        size_t count = 0; // Number of positions in the page.
+    };
+
+    coordinate_t size_x{};
+    coordinate_t size_y{};
+    std::vector<std::unique_ptr<Page>> pages;
+    std::vector<size_t> used_pages; // Sorted indexes of pages with positions inserted since clear.
+    size_t count = 0;
+
+
+    [[nodiscard]] size_t get_bit(Position position) const {
+        return (size_t) position.get_x() * size_y + position.get_y();
+    }
+
+    // Returns the page for bit 'bit' (allocating it if needed) and marks it as used.
+    Page &get_used_page(size_t bit) {
+        size_t page_index = bit / PAGE_BITS;
+        std::unique_ptr<Page> &page = pages[page_index];
+        if (page == nullptr) {
+            page = std::make_unique<Page>();
+        }
+        if (page->count == 0) {
+            auto it = std::lower_bound(used_pages.begin(), used_pages.end(), page_index);
+            if (it == used_pages.end() || *it != page_index) {
+                used_pages.insert(it, page_index);
+            }
+        }
+        return *page;
+    }
+
+    // Sets bits of 'mask' in word 'word' of 'page'.
+    void set_bits(Page &page, size_t word, uint64_t mask) {
+        auto new_bits = (size_t) std::popcount(mask & ~page.words[word]);
+        page.words[word] |= mask;
+        page.count += new_bits;
+        count += new_bits;
+    }
+
+public:
+    class const_iterator {
+    private:
+        const PositionSet *set = nullptr;
+        size_t used_page = 0; // Index in 'used_pages'.
+        size_t word = 0;
+        uint64_t bits = 0; // Bits of the current word not visited yet.
+
+        // Moves to the first word with bits not visited yet (starting with the current one).
+        void skip_empty_words() {
+            while (bits == 0) {
+                if (++word == PAGE_WORDS) {
+                    word = 0;
+                    if (++used_page == set->used_pages.size()) {
+                        return;
+                    }
+                }
+                bits = set->pages[set->used_pages[used_page]]->words[word];
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Position;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Position *;
+        using reference = Position;
+
+        const_iterator() = default;
+        const_iterator(const PositionSet *set, size_t used_page) : set(set), used_page(used_page) {
+            if (used_page < set->used_pages.size()) {
+                bits = set->pages[set->used_pages[used_page]]->words[0];
+                skip_empty_words();
+            }
+        }
+
+        Position operator*() const {
+            size_t bit = set->used_pages[used_page] * PAGE_BITS + word * WORD_BITS +
+                         (size_t) std::countr_zero(bits);
+            return {(coordinate_t) (bit / set->size_y), (coordinate_t) (bit % set->size_y)};
+        }
+
+        const_iterator &operator++() {
+            bits &= bits - 1;
+            skip_empty_words();
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const const_iterator &that) const {
+            return used_page == that.used_page && word == that.word && bits == that.bits;
+        }
+    };
+
+    PositionSet() = default;
+    PositionSet(const PositionSet &that) : size_x(that.size_x), size_y(that.size_y),
+                                           pages(that.pages.size()), used_pages(that.used_pages),
+                                           count(that.count) {
+        for (size_t page: used_pages) {
+            pages[page] = std::make_unique<Page>(*that.pages[page]);
+        }
+    }
+    PositionSet &operator=(const PositionSet &that) {
+        if (this != &that) {
+            PositionSet copy(that);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+    PositionSet(PositionSet &&) = default;
+    PositionSet &operator=(PositionSet &&) = default;
+
+    // Empties the set and makes it hold positions on a board of given size.
+    void resize(coordinate_t new_size_x, coordinate_t new_size_y) {
+        size_x = new_size_x;
+        size_y = new_size_y;
+        pages.clear();
+        pages.resize(((size_t) size_x * size_y + PAGE_BITS - 1) / PAGE_BITS);
+        used_pages.clear();
+        count = 0;
+    }
+
+    [[nodiscard]] coordinate_t get_size_x() const {
+        return size_x;
+    }
+
+    [[nodiscard]] coordinate_t get_size_y() const {
+        return size_y;
+    }
+
+    [[nodiscard]] bool is_on_board(coordinate_t x, coordinate_t y) const {
+        return x < size_x && y < size_y;
+    }
+
+    [[nodiscard]] bool is_on_board(Position position) const {
+        return is_on_board(position.get_x(), position.get_y());
+    }
+
+    [[nodiscard]] bool contains(Position position) const {
+        if (!is_on_board(position)) {
+            return false;
+        }
+        size_t bit = get_bit(position);
+        const Page *page = pages[bit / PAGE_BITS].get();
+        return page != nullptr &&
+               (page->words[bit % PAGE_BITS / WORD_BITS] >> (bit % WORD_BITS) & 1) != 0;
+    }
+
+
+    void insert(Position position) {
+        if (!is_on_board(position)) {
+            throw std::invalid_argument("Position outside of the board");
+        }
+        size_t bit = get_bit(position);
+        set_bits(get_used_page(bit), bit % PAGE_BITS / WORD_BITS, (uint64_t) 1 << (bit % WORD_BITS));
+    }
+
+    // Inserts positions (x, y) for all y from 'from_y' to 'to_y' (inclusive). They are
+    // consecutive bits of the set, so they are inserted a word at a time.
+    void insert_column(coordinate_t x, coordinate_t from_y, coordinate_t to_y) {
+        if (!is_on_board(x, to_y) || from_y > to_y) {
+            throw std::invalid_argument("Position outside of the board");
+        }
+        size_t bit = get_bit(Position(x, from_y));
+        size_t last_bit = get_bit(Position(x, to_y));
+        while (bit <= last_bit) {
+            size_t word_end = std::min(bit / WORD_BITS * WORD_BITS + WORD_BITS - 1, last_bit);
+            uint64_t mask = (~UINT64_C(0) >> (WORD_BITS - 1 - word_end % WORD_BITS)) &
+                            (~UINT64_C(0) << (bit % WORD_BITS));
+            set_bits(get_used_page(bit), bit % PAGE_BITS / WORD_BITS, mask);
+            bit = word_end + 1;
+        }
+    }
+
+    void erase(Position position) {
+        if (!is_on_board(position)) {
+            return;
+        }
+        size_t bit = get_bit(position);
+        Page *page = pages[bit / PAGE_BITS].get();
+        if (page == nullptr) {
+            return;
+        }
+        uint64_t &word = page->words[bit % PAGE_BITS / WORD_BITS];
+        uint64_t mask = (uint64_t) 1 << (bit % WORD_BITS);
+        if ((word & mask) != 0) {
+            word &= ~mask;
+            page->count--;
+            count--;
+        }
+    }
+
+    // Removes all positions (keeping allocated pages for reuse).
+    void clear() {
+        for (size_t page: used_pages) {
+            pages[page]->words.fill(0);
+            pages[page]->count = 0;
+        }
+        used_pages.clear();
+        count = 0;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return count;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return count == 0;
+    }
+
+    // Positions are visited in increasing order.
+    [[nodiscard]] const_iterator begin() const {
+        return {this, 0};
+    }
+
+    [[nodiscard]] const_iterator end() const {
+        return {this, used_pages.size()};
+    }
+};
+
+// Blocks on the board: the set of their positions and, depending on the explosion engine (on
+// boards which aren't too large), their bitboard or blast extents used to calculate explosions.
+class BlockSet {
+private:
+    PositionSet positions;
+    BlockBitboard bitboard;
+    BlastExtents extents;
+
+    void update_extents(Position position) {
+        extents.update(position.get_x(), position.get_y(), [this](coordinate_t x, coordinate_t y) {
+            return positions.contains(Position(x, y));
+        });
+    }
+
+public:
+    using const_iterator = PositionSet::const_iterator;
+
+    // Empties the set and makes it hold positions on a board of given size.
+    void resize(coordinate_t size_x, coordinate_t size_y, ExplosionEngine engine) {
+        size_t fields = (size_t) size_x * size_y;
+        positions.resize(size_x, size_y);
+        bitboard.resize(size_x, size_y,
+                        engine == ExplosionEngine::Bitboard && fields <= BITBOARD_MAX_FIELDS);
+        extents.resize(size_x, size_y,
+                       engine == ExplosionEngine::Extents && fields <= BLAST_EXTENTS_MAX_FIELDS);
+    }
+
+    [[nodiscard]] bool contains(Position position) const {
+        return positions.contains(position);
+    }
+
+    void insert(Position position) {
+        if (positions.contains(position)) {
+            return;
+        }
+        positions.insert(position);
+        if (bitboard.is_enabled()) {
+            bitboard.insert(position.get_x(), position.get_y());
+        }
+        if (extents.is_enabled()) {
+            update_extents(position);
+        }
+    }
+
+    void erase(Position position) {
+        if (positions.contains(position)) {
+            positions.erase(position);
+            if (bitboard.is_enabled()) {
+                bitboard.erase(position.get_x(), position.get_y());
+            }
+            if (extents.is_enabled()) {
+                update_extents(position);
+            }
+        }
+    }
+
+    void clear() {
+        positions.clear();
+        bitboard.clear();
+        extents.clear();
+    }
+
+    [[nodiscard]] size_t size() const {
+        return positions.size();
+    }
+
+    [[nodiscard]] bool empty() const {
+        return positions.empty();
+    }
+
+    [[nodiscard]] const BlockBitboard &get_bitboard() const {
+        return bitboard;
+    }
+
+    [[nodiscard]] const BlastExtents &get_extents() const {
+        return extents;
+    }
+
+    [[nodiscard]] const_iterator begin() const {
+        return positions.begin();
+    }
+
+    [[nodiscard]] const_iterator end() const {
+        return positions.end();
+    }
+};
+
+// Map from player ids to values, kept in an array indexed by player id. Players are visited in
+// increasing order of ids.
+template <typename T>
+class PlayerMap {
+private:
+    static constexpr size_t WORD_BITS = 64;
+    static constexpr size_t PLAYER_IDS = PLAYERS_COUNT_MAX + 1;
+
+    std::array<T, PLAYER_IDS> values{};
+    std::array<uint64_t, PLAYER_IDS / WORD_BITS> present{};
+
+public:
+    using mapped_type = T;
+
+    class const_iterator {
+    private:
+        const PlayerMap *map = nullptr;
+        size_t id = PLAYER_IDS;
+
+        // Moves to the first present player id not less than 'id'.
+        void skip_absent_ids() {
+            while (id < PLAYER_IDS) {
+                uint64_t bits = map->present[id / WORD_BITS] >> (id % WORD_BITS);
+                if (bits != 0) {
+                    id += (size_t) std::countr_zero(bits);
+                    return;
+                }
+                id = (id / WORD_BITS + 1) * WORD_BITS;
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<player_id_t, const T &>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        const_iterator() = default;
+        const_iterator(const PlayerMap *map, size_t id) : map(map), id(id) {
+            skip_absent_ids();
+        }
+
+        value_type operator*() const {
+            return {(player_id_t) id, map->values[id]};
+        }
+
+        const_iterator &operator++() {
+            id++;
+            skip_absent_ids();
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const const_iterator &that) const {
+            return id == that.id;
+        }
+    };
+
+    // Returns the value for player 'id', inserting a default one if needed.
+    T &operator[](player_id_t id) {
+        if (!contains(id)) {
+            present[id / WORD_BITS] |= (uint64_t) 1 << (id % WORD_BITS);
+            values[id] = T();
+        }
+        return values[id];
+    }
+
+    // Returns the value for player 'id' (a default one if there is none).
+    [[nodiscard]] const T &get(player_id_t id) const {
+        return values[id];
+    }
+
+    [[nodiscard]] bool contains(player_id_t id) const {
+        return (present[id / WORD_BITS] >> (id % WORD_BITS) & 1) != 0;
+    }
+
+    void erase(player_id_t id) {
+        present[id / WORD_BITS] &= ~((uint64_t) 1 << (id % WORD_BITS));
+    }
+
+    void clear() {
+        present.fill(0);
+    }
+
+    [[nodiscard]] size_t size() const {
+        size_t size = 0;
+        for (uint64_t bits: present) {
+            size += (size_t) std::popcount(bits);
+        }
+        return size;
+    }
+
+    [[nodiscard]] const_iterator begin() const {
+        return {this, 0};
+    }
+
+    [[nodiscard]] const_iterator end() const {
+        return {this, PLAYER_IDS};
+    }
+};
+
+// Positions of robots, with an index of robots standing on every field, so robots reached by an
+// explosion are found by visiting only the fields of the explosion. The index is a fixed-size
+// open addressing hash table (with linear probing) from a field to the set of robots on it.
+class RobotPositions {
+private:
+    static constexpr size_t WORD_BITS = 64;
+    static constexpr size_t PLAYER_IDS = PLAYERS_COUNT_MAX + 1;
+    // At least twice the number of robots, so every probe sequence is short.
+    static constexpr size_t INDEX_SIZE = 2 * PLAYER_IDS;
+
+    struct Field {
+        uint32_t key = 0;
+        std::array<uint64_t, PLAYER_IDS / WORD_BITS> robots{}; // Empty field if no robots.
+
+        [[nodiscard]] bool is_empty() const {
+            return std::all_of(robots.begin(), robots.end(), [](uint64_t bits) {
+                return bits == 0;
+            });
+        }
+    };
+
+    PlayerMap<Position> positions;
+    std::array<Field, INDEX_SIZE> index{};
+
+    static uint32_t get_key(Position position) {
+        return (uint32_t) position.get_x() << 16 | position.get_y();
+    }
+
+    static size_t get_slot(uint32_t key) {
+        return (size_t) (key * UINT32_C(0x9E3779B1) >> 23) % INDEX_SIZE;
+    }
+
+    // Returns the slot of the field with 'key', or of the empty slot where it belongs.
+    [[nodiscard]] size_t find_slot(uint32_t key) const {
+        size_t slot = get_slot(key);
+        while (!index[slot].is_empty() && index[slot].key != key) {
+            slot = (slot + 1) % INDEX_SIZE;
+        }
+        return slot;
+    }
+
+    void add_to_index(player_id_t id, Position position) {
+        uint32_t key = get_key(position);
+        Field &field = index[find_slot(key)];
+        field.key = key;
+        field.robots[id / WORD_BITS] |= (uint64_t) 1 << (id % WORD_BITS);
+    }
+
+    void remove_from_index(player_id_t id, Position position) {
+        size_t slot = find_slot(get_key(position));
+        index[slot].robots[id / WORD_BITS] &= ~((uint64_t) 1 << (id % WORD_BITS));
+        if (!index[slot].is_empty()) {
+            return;
+        }
+        // Move back fields following the removed one in its probe sequence, so none of them
+        // is separated from its home slot by an empty slot.
+        size_t empty = slot;
+        for (size_t next = (slot + 1) % INDEX_SIZE; !index[next].is_empty();
+             next = (next + 1) % INDEX_SIZE) {
+            size_t home = get_slot(index[next].key);
+            if ((next + INDEX_SIZE - home) % INDEX_SIZE >= (next + INDEX_SIZE - empty) % INDEX_SIZE) {
+                index[empty] = index[next];
+                index[next].robots.fill(0);
+                empty = next;
+            }
+        }
+    }
+
+public:
+    using mapped_type = Position;
+    using const_iterator = PlayerMap<Position>::const_iterator;
+
+    // Places robot 'id' on 'position' (moving it from its previous position if it has one).
+    void move(player_id_t id, Position position) {
+        if (positions.contains(id)) {
+            remove_from_index(id, positions.get(id));
+        }
+        positions[id] = position;
+        add_to_index(id, position);
+    }
+
+    // Returns the position of robot 'id'.
+    const Position &operator[](player_id_t id) const {
+        return positions.get(id);
+    }
+
+    [[nodiscard]] bool contains(player_id_t id) const {
+        return positions.contains(id);
+    }
+
+    // Calls 'visit' with the id of every robot standing on 'position'.
+    template <typename Visit>
+    void for_each_robot_on(Position position, Visit &&visit) const {
+        const Field &field = index[find_slot(get_key(position))];
+        for (size_t word = 0; word < field.robots.size(); word++) {
+            for (uint64_t bits = field.robots[word]; bits != 0; bits &= bits - 1) {
+                visit((player_id_t) (word * WORD_BITS + (size_t) std::countr_zero(bits)));
+            }
+        }
+    }
+
+    void clear() {
+        positions.clear();
+        for (Field &field: index) {
+            field.robots.fill(0);
+        }
+    }
+
+    [[nodiscard]] size_t size() const {
+        return positions.size();
+    }
+
+    [[nodiscard]] const_iterator begin() const {
+        return positions.begin();
+    }
+
+    [[nodiscard]] const_iterator end() const {
+        return positions.end();
+    }
+};
+
+// Inserts a list of pairs of a player id and a value (a score or a position) into buffer with
+// a single bounds check.
+template <typename Map>
+void insert_player_list_to_buffer(Buffer &buffer, const Map &values) {
+    using Value = typename Map::mapped_type;
+    ListLengthLayout::insert(buffer, (list_length_t) values.size());
+    constexpr size_t element_size = PLAYER_ID_SIZE + sizeof(Value);
+    char *data = buffer.reserve(values.size() * element_size);
+    for (auto const & [player_id, value]: values) {
+        store(data, player_id);
+        if constexpr (std::is_same_v<Value, Position>) {
+            store(data + PLAYER_ID_SIZE, value.get_x());
+            store(data + PLAYER_ID_SIZE + COORDINATE_SIZE, value.get_y());
+        } else {
+            store(data + PLAYER_ID_SIZE, value);
+        }
+        data += element_size;
+    }
+}
+
 class Bomb {
 private:
     Position position;
-    bomb_timer_t timer{};
+    explosion_turn_t explosion_turn{}; // The timer is computed from the current turn.
 
 public:
     Bomb() = default;
-    explicit Bomb(Buffer &buffer) {
-        Position position_copy(buffer);
-        position = position_copy;
-        buffer.get(timer, BOMB_TIMER_SIZE);
+    Bomb(Position position, explosion_turn_t explosion_turn) :
+            position(position), explosion_turn(explosion_turn) {}
+
+    void insert_to_buffer(Buffer &buffer, turn_t turn) const {
+        BombLayout::insert(buffer, position.get_x(), position.get_y(), get_timer(turn));
     }
-    Bomb(Position position, bomb_timer_t timer) : position(position), timer(timer) {}
 
-    void decrease_timer() {
-        timer--;
+    [[nodiscard]] Position get_position() const {
+        return position;
     }
 
-    void insert_to_buffer(Buffer &buffer) const {
-        position.insert_to_buffer(buffer);
-        buffer.insert(timer, BOMB_TIMER_SIZE);
+    [[nodiscard]] explosion_turn_t get_explosion_turn() const {
+        return explosion_turn;
     }
 
-    Position get_position() {
-        return position;
+    // Returns the timer of the bomb in 'turn'.
+    [[nodiscard]] bomb_timer_t get_timer(turn_t turn) const {
+        return (bomb_timer_t) (explosion_turn - turn);
+    }
+};
+
+// Bombs on the board by their ids, with a timing wheel of turns in which they explode: bucket
+// 'turn % wheel size' has ids of bombs exploding in 'turn' (or in turns a multiple of the wheel
+// size later). The wheel is larger than the bomb timer, so all bombs of a bucket explode in the
+// same turn, and a turn finds its exploding bombs without visiting the others.
+class BombMap {
+private:
+    static constexpr size_t MIN_WHEEL_SIZE = 16;
+
+    // Nodes of erased bombs are reused for new ones. Buckets take their memory from the pool
+    // too and give it back once all their bombs have exploded, so with a long bomb timer the
+    // buckets of later turns reuse it instead of each growing its own.
+    std::pmr::unsynchronized_pool_resource nodes;
+    std::pmr::map<bomb_id_t, Bomb> bombs{&nodes};
+    std::vector<std::pmr::vector<bomb_id_t>> wheel;
+
+    std::pmr::vector<bomb_id_t> &get_bucket(explosion_turn_t turn) {
+        return wheel[turn & (wheel.size() - 1)];
+    }
+
+public:
+    using const_iterator = std::pmr::map<bomb_id_t, Bomb>::const_iterator;
+
+    BombMap() {
+        resize(0);
     }
 
-    [[nodiscard]] bomb_timer_t get_timer() const {
-        return timer;
+    // Empties the map and sizes the wheel for bombs placed with 'bomb_timer'.
+    void resize(bomb_timer_t bomb_timer) {
+        clear();
+        size_t wheel_size = std::max(MIN_WHEEL_SIZE, std::bit_ceil((size_t) bomb_timer + 1));
+        // Buckets are constructed in place, as copies of a bucket wouldn't use the pool.
+        wheel.clear();
+        wheel.reserve(wheel_size);
+        while (wheel.size() < wheel_size) {
+            wheel.emplace_back(&nodes);
+        }
+    }
+
+    // Inserts a bomb (replacing a bomb with the same id).
+    void insert(bomb_id_t id, Bomb bomb) {
+        erase(id);
+        bombs.emplace(id, bomb);
+        get_bucket(bomb.get_explosion_turn()).push_back(id);
+    }
+
+    [[nodiscard]] bool contains(bomb_id_t id) const {
+        return bombs.contains(id);
+    }
+
+    [[nodiscard]] const Bomb &operator[](bomb_id_t id) const {
+        auto bomb = bombs.find(id);
+        if (bomb == bombs.end()) {
+            throw std::invalid_argument("Bomb doesn't exist");
+        }
+        return bomb->second;
+    }
+
+    void erase(bomb_id_t id) {
+        auto bomb = bombs.find(id);
+        if (bomb == bombs.end()) {
+            return;
+        }
+        std::pmr::vector<bomb_id_t> &bucket = get_bucket(bomb->second.get_explosion_turn());
+        auto bucket_id = std::find(bucket.begin(), bucket.end(), id);
+        *bucket_id = bucket.back();
+        bucket.pop_back();
+        bombs.erase(bomb);
+    }
+
+    // Returns ids of bombs exploding in 'turn', in increasing order.
+    std::span<const bomb_id_t> get_exploding(explosion_turn_t turn) {
+        std::pmr::vector<bomb_id_t> &bucket = get_bucket(turn);
+        auto exploding_end = std::partition(bucket.begin(), bucket.end(), [&](bomb_id_t id) {
+            return bombs.find(id)->second.get_explosion_turn() == turn;
+        });
+        std::sort(bucket.begin(), exploding_end);
+        return {bucket.begin(), exploding_end};
+    }
+
+    // Erases bombs exploding in 'turn'.
+    void erase_exploding(explosion_turn_t turn) {
+        std::pmr::vector<bomb_id_t> &bucket = get_bucket(turn);
+        std::erase_if(bucket, [&](bomb_id_t id) {
+            auto bomb = bombs.find(id);
+            if (bomb->second.get_explosion_turn() != turn) {
+                return false;
+            }
+            bombs.erase(bomb);
+            return true;
+        });
+        if (bucket.empty()) {
+            bucket = std::pmr::vector<bomb_id_t>(&nodes);
+        }
+    }
+
+    void clear() {
+        bombs.clear();
+        for (auto & bucket: wheel) {
+            bucket.clear();
+        }
+    }
+
+    [[nodiscard]] size_t size() const {
+        return bombs.size();
+    }
+
+    [[nodiscard]] const_iterator begin() const {
+        return bombs.begin();
+    }
+
+    [[nodiscard]] const_iterator end() const {
+        return bombs.end();
     }
 };
 
@@ -111,15 +834,39 @@ struct GameState {
     bomb_timer_t bomb_timer{};
     turn_t turn{};
     std::map<player_id_t, Player> players;
-    std::map<player_id_t, Position> player_positions;
-    std::set<Position> blocks;
-    std::map<bomb_id_t, Bomb> bombs;
-    std::set<Position> explosions;
+    RobotPositions player_positions;
+    BlockSet blocks;
+    BombMap bombs;
+    PositionSet explosions;
     std::map<player_id_t, score_t> scores;
+    ExplosionEngine explosion_engine = ExplosionEngine::Bitboard; // Set before 'resize_board'.
     // Attributes used by server only.
     turn_duration_t turn_duration{};
     initial_blocks_t initial_blocks{};
     seed_t seed{};
+
+    // Copies parameters of the game (but not its state) from 'rules'.
+    void set_rules(const GameState &rules) {
+        server_name = rules.server_name;
+        players_count = rules.players_count;
+        size_x = rules.size_x;
+        size_y = rules.size_y;
+        game_length = rules.game_length;
+        explosion_radius = rules.explosion_radius;
+        bomb_timer = rules.bomb_timer;
+        explosion_engine = rules.explosion_engine;
+        turn_duration = rules.turn_duration;
+        initial_blocks = rules.initial_blocks;
+        seed = rules.seed;
+    }
+
+    // Sizes sets of positions on the board and bombs (and empties them), after setting the size
+    // of the board and the bomb timer.
+    void resize_board() {
+        blocks.resize(size_x, size_y, explosion_engine);
+        explosions.resize(size_x, size_y);
+        bombs.resize(bomb_timer);
+    }
 };
 
 // Id number generator used by server for clients, players and bombs.
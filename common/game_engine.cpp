@@ -0,0 +1,261 @@
+#include "game_engine.h"
+
+Position GameEngine::get_random_position() {
+    auto x = (coordinate_t) (random() % game_state.size_x);
+    auto y = (coordinate_t) (random() % game_state.size_y);
+    return {x, y};
+}
+
+void GameEngine::process_bombs(std::bitset<PLAYERS_COUNT_MAX + 1> &current_turn_robots_destroyed) {
+    // Only bombs exploding in this turn are visited (in the order of their ids).
+    std::span<const bomb_id_t> bombs_exploding = game_state.bombs.get_exploding(game_state.turn);
+    if (explosion_pool) {
+        explosion_pool->add_bombs_exploded(bombs_exploding, game_state, events);
+    } else {
+        for (bomb_id_t bomb_id: bombs_exploding) {
+            // Explosion - insert a BombExploded event.
+            events.add_bomb_exploded(bomb_id, game_state);
+            // Clear explosions set.
+            game_state.explosions.clear();
+        }
+    }
+    // Remove exploded bombs.
+    game_state.bombs.erase_exploding(game_state.turn);
+    for (player_id_t robot_destroyed: events.get_robots_destroyed()) {
+        current_turn_robots_destroyed.set(robot_destroyed);
+    }
+    // Remove destroyed blocks.
+    for (Position block_destroyed: events.get_blocks_destroyed()) {
+        game_state.blocks.erase(block_destroyed);
+    }
+}
+
+void GameEngine::process_place_bomb(player_id_t player_id) {
+    bomb_id_t bomb_id = bomb_id_generator.generate_id();
+    Position position = game_state.player_positions[player_id];
+    game_state.bombs.insert(bomb_id, Bomb(position, (explosion_turn_t) game_state.turn +
+                                                    game_state.bomb_timer));
+    // Insert a BombPlaced event.
+    events.add_bomb_placed(bomb_id, position);
+}
+
+void GameEngine::process_place_block(player_id_t player_id) {
+    Position position = game_state.player_positions[player_id];
+    if (!game_state.blocks.contains(position)) {
+        game_state.blocks.insert(position);
+        // Insert a BlockPlaced event.
+        events.add_block_placed(position);
+    }
+}
+
+Position GameEngine::get_moved_position(Position position, direction_t direction) const {
+    coordinate_t x = position.get_x();
+    coordinate_t y = position.get_y();
+    Position new_position = position;
+    switch (static_cast<Direction>(direction)) {
+        case Direction::Up:
+            if (y < game_state.size_y - 1) {
+                new_position = Position(x, (coordinate_t) (y + 1));
+            }
+            break;
+        case Direction::Right:
+            if (x < game_state.size_x - 1) {
+                new_position = Position((coordinate_t) (x + 1), y);
+            }
+            break;
+        case Direction::Down:
+            if (y > 0) {
+                new_position = Position(x, (coordinate_t) (y - 1));
+            }
+            break;
+        case Direction::Left:
+            if (x > 0) {
+                new_position = Position((coordinate_t) (x - 1), y);
+            }
+            break;
+    }
+    return new_position;
+}
+
+void GameEngine::process_move(player_id_t player_id, direction_t direction) {
+    Position position = game_state.player_positions[player_id];
+    Position new_position = get_moved_position(position, direction);
+    if (new_position != position && !game_state.blocks.contains(new_position)) {
+        game_state.player_positions.move(player_id, new_position);
+        // Insert a PlayerMoved event.
+        events.add_player_moved(player_id, new_position);
+    }
+}
+
+void GameEngine::process_player_moves(
+        const TurnMessages &current_turn_messages,
+        const std::bitset<PLAYERS_COUNT_MAX + 1> &current_turn_robots_destroyed) {
+    for (auto & [player_id, player] : game_state.players) {
+        if (!current_turn_robots_destroyed.test(player_id)) {
+            // Robot wasn't destroyed.
+            const PlayerInput &input = current_turn_messages[player_id];
+            if (!input.empty()) {
+                // Player made a move.
+                switch (input.get_type()) {
+                    case ClientMessageType::PlaceBomb: {
+                        process_place_bomb(player_id);
+                        break;
+                    }
+                    case ClientMessageType::PlaceBlock: {
+                        process_place_block(player_id);
+                        break;
+                    }
+                    case ClientMessageType::Move: {
+                        direction_t direction = input.get_direction();
+                        process_move(player_id, direction);
+                        break;
+                    }
+                    default:
+                        break;
+                }
+            }
+        } else {
+            // Robot was destroyed.
+            game_state.scores[player_id]++;
+            Position position = get_random_position();
+            game_state.player_positions.move(player_id, position);
+            events.add_player_moved(player_id, position);
+        }
+    }
+}
+
+void GameEngine::evaluate_player_action(
+        PlayerAction &action, const TurnMessages &current_turn_messages,
+        const std::bitset<PLAYERS_COUNT_MAX + 1> &current_turn_robots_destroyed) const {
+    action.type = PlayerActionType::None;
+    if (current_turn_robots_destroyed.test(action.player_id)) {
+        action.type = PlayerActionType::Respawn;
+        return;
+    }
+    const PlayerInput &input = current_turn_messages[action.player_id];
+    if (input.empty()) {
+        return;
+    }
+    Position position = game_state.player_positions[action.player_id];
+    switch (input.get_type()) {
+        case ClientMessageType::PlaceBomb:
+            action.type = PlayerActionType::PlaceBomb;
+            break;
+        case ClientMessageType::PlaceBlock:
+            if (!game_state.blocks.contains(position)) {
+                action.type = PlayerActionType::PlaceBlock;
+                action.position = position;
+            }
+            break;
+        case ClientMessageType::Move: {
+            Position new_position = get_moved_position(position, input.get_direction());
+            if (new_position != position && !game_state.blocks.contains(new_position)) {
+                action.type = PlayerActionType::Move;
+                action.position = new_position;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void GameEngine::resolve_player_actions(
+        const TurnMessages &current_turn_messages,
+        const std::bitset<PLAYERS_COUNT_MAX + 1> &current_turn_robots_destroyed) {
+    // Evaluate actions of all players at once.
+    player_actions.clear();
+    for (auto const & [player_id, player]: game_state.players) {
+        player_actions.push_back({player_id, PlayerActionType::None, Position()});
+    }
+    size_t players = player_actions.size();
+    size_t parts = players < MIN_PARALLEL_PLAYERS ? 1 : action_thread_pool->size();
+    action_thread_pool->run(parts, [&](size_t part) {
+        for (size_t i = players * part / parts; i < players * (part + 1) / parts; i++) {
+            evaluate_player_action(player_actions[i], current_turn_messages,
+                                   current_turn_robots_destroyed);
+        }
+    });
+
+    // Apply them in the order of player ids. Blocks on the board before any action were checked
+    // by the evaluation, so only blocks placed by earlier players can conflict with an action.
+    bool blocks_placed = false;
+    for (PlayerAction const & action: player_actions) {
+        switch (action.type) {
+            case PlayerActionType::None:
+                break;
+            case PlayerActionType::Respawn: {
+                game_state.scores[action.player_id]++;
+                Position position = get_random_position();
+                game_state.player_positions.move(action.player_id, position);
+                events.add_player_moved(action.player_id, position);
+                break;
+            }
+            case PlayerActionType::PlaceBomb:
+                process_place_bomb(action.player_id);
+                break;
+            case PlayerActionType::PlaceBlock:
+                if (!blocks_placed || !game_state.blocks.contains(action.position)) {
+                    game_state.blocks.insert(action.position);
+                    events.add_block_placed(action.position);
+                    blocks_placed = true;
+                }
+                break;
+            case PlayerActionType::Move:
+                if (!blocks_placed || !game_state.blocks.contains(action.position)) {
+                    game_state.player_positions.move(action.player_id, action.position);
+                    events.add_player_moved(action.player_id, action.position);
+                }
+                break;
+        }
+    }
+}
+
+const TurnEvents &GameEngine::initialize_game_state() {
+    game_state.turn = TURN_ZERO;
+    events.clear();
+
+    // Place players' robots in random positions.
+    for (auto & [player_id, player]: game_state.players) {
+        Position position = get_random_position();
+        game_state.player_positions.move(player_id, position);
+        // Insert a PlayerMoved event.
+        events.add_player_moved(player_id, position);
+    }
+
+    // Place blocks in random positions.
+    for (initial_blocks_t i = 0; i < game_state.initial_blocks; i++) {
+        Position position = get_random_position();
+        if (!game_state.blocks.contains(position)) {
+            game_state.blocks.insert(position);
+            // Insert a BlockPlaced event.
+            events.add_block_placed(position);
+        }
+    }
+
+    return events;
+}
+
+const TurnEvents &GameEngine::run_turn(turn_t turn, const TurnMessages &current_turn_messages) {
+    game_state.turn = turn;
+    events.clear();
+    std::bitset<PLAYERS_COUNT_MAX + 1> current_turn_robots_destroyed;
+
+    process_bombs(current_turn_robots_destroyed);
+    if (action_thread_pool) {
+        resolve_player_actions(current_turn_messages, current_turn_robots_destroyed);
+    } else {
+        process_player_moves(current_turn_messages, current_turn_robots_destroyed);
+    }
+
+    return events;
+}
+
+void GameEngine::reset_game_state() {
+    game_state.player_positions.clear();
+    game_state.blocks.clear();
+    game_state.bombs.clear();
+    game_state.explosions.clear();
+    game_state.scores.clear();
+    bomb_id_generator.reset();
+}
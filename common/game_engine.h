@@ -0,0 +1,103 @@
+#ifndef GAME_ENGINE_H
+#define GAME_ENGINE_H
+
+#include <array>
+#include <bitset>
+#include <random>
+#include "explosion_pool.h"
+#include "messages.h"
+
+constexpr turn_t TURN_ZERO = 0;
+// Actions of fewer players are evaluated by the thread running the game only.
+constexpr size_t MIN_PARALLEL_PLAYERS = 32;
+
+// The last messages of players sent during a turn, indexed by their ids.
+class TurnMessages {
+private:
+    std::array<PlayerInput, PLAYERS_COUNT_MAX + 1> inputs{};
+
+public:
+    PlayerInput &operator[](player_id_t player_id) {
+        return inputs[player_id];
+    }
+
+    const PlayerInput &operator[](player_id_t player_id) const {
+        return inputs[player_id];
+    }
+};
+
+enum class PlayerActionType : uint8_t {
+    None,
+    Respawn,
+    PlaceBomb,
+    PlaceBlock,
+    Move
+};
+
+// Action of a player in a turn, evaluated against the board before actions of other players.
+struct PlayerAction {
+    player_id_t player_id;
+    PlayerActionType type;
+    Position position; // Of a block placed or the robot after a move.
+};
+
+// Rules of the game: places robots and blocks at the beginning of a game and runs its turns on
+// 'game_state' (whose players are already set), returning their events. It neither sends nor
+// receives messages, so the server and simulations of games run exactly the same rules.
+class GameEngine {
+private:
+    GameState &game_state;
+    std::minstd_rand random;
+    IdGenerator<bomb_id_t> bomb_id_generator;
+    TurnEvents events; // Events of the current turn (reused by all turns).
+    // Threads calculating explosions and evaluating actions of players of a turn (if there is
+    // more than one thread for them).
+    std::unique_ptr<ThreadPool> explosion_thread_pool;
+    std::unique_ptr<ExplosionPool> explosion_pool;
+    std::unique_ptr<ThreadPool> action_thread_pool;
+    std::vector<PlayerAction> player_actions; // Of the current turn, in the order of player ids.
+
+    Position get_random_position();
+
+    void process_bombs(std::bitset<PLAYERS_COUNT_MAX + 1> &current_turn_robots_destroyed);
+    void process_place_bomb(player_id_t player_id);
+    void process_place_block(player_id_t player_id);
+    [[nodiscard]] Position get_moved_position(Position position, direction_t direction) const;
+    void process_move(player_id_t player_id, direction_t direction);
+    void process_player_moves(const TurnMessages &current_turn_messages,
+                              const std::bitset<PLAYERS_COUNT_MAX + 1> &current_turn_robots_destroyed);
+    // Sets the type (and position) of 'action' from the message of its player. It only reads
+    // the state of the game, so actions of all players are evaluated at once.
+    void evaluate_player_action(
+            PlayerAction &action, const TurnMessages &current_turn_messages,
+            const std::bitset<PLAYERS_COUNT_MAX + 1> &current_turn_robots_destroyed) const;
+    // Does the same as 'process_player_moves', evaluating actions of players on threads of
+    // 'action_thread_pool' and applying them (and resolving conflicts between them) one by one.
+    void resolve_player_actions(
+            const TurnMessages &current_turn_messages,
+            const std::bitset<PLAYERS_COUNT_MAX + 1> &current_turn_robots_destroyed);
+
+public:
+    // Random positions are drawn from a generator seeded with 'game_state.seed'.
+    explicit GameEngine(GameState &game_state, size_t explosion_threads = 1,
+                        size_t action_threads = 1) :
+            game_state(game_state), random(game_state.seed) {
+        if (explosion_threads > 1) {
+            explosion_thread_pool = std::make_unique<ThreadPool>(explosion_threads);
+            explosion_pool = std::make_unique<ExplosionPool>(*explosion_thread_pool);
+        }
+        if (action_threads > 1) {
+            action_thread_pool = std::make_unique<ThreadPool>(action_threads);
+        }
+    }
+
+    // Places robots of players and initial blocks, and returns events of turn 0. The events are
+    // valid until the next call.
+    const TurnEvents &initialize_game_state();
+    // Runs a turn with the last messages of players sent during it, and returns its events.
+    const TurnEvents &run_turn(turn_t turn, const TurnMessages &current_turn_messages);
+    // Clears the board and scores (but not players) for the next game.
+    void reset_game_state();
+};
+
+#endif //GAME_ENGINE_H
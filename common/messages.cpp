@@ -1,4 +1,6 @@
 #include "messages.h"
+#include "compact.h"
+#include "turn_view.h"
 
 #include <utility>
 
@@ -11,7 +13,7 @@ InputMessage::InputMessage(Buffer &buffer) {
     }
 
     message_id_t message_id;
-    buffer.get(message_id, MESSAGE_ID_SIZE);
+    MessageIdLayout::get(buffer, message_id);
     type = static_cast<InputMessageType>(message_id);
 
     switch (type) {
@@ -27,7 +29,7 @@ InputMessage::InputMessage(Buffer &buffer) {
                 return;
             }
 
-            buffer.get(direction, DIRECTION_SIZE);
+            MoveLayout::get(buffer, direction);
             switch (static_cast<Direction>(message_id)) {
                 case Direction::Up:
                 case Direction::Right:
@@ -83,7 +85,7 @@ ClientMessage::ClientMessage(InputMessage input_message, GameState &game_state,
 // Gets a ClientMessage message from buffer and updates 'game_state' accordingly.
 ClientMessage::ClientMessage(Buffer &buffer) {//, GameState &game_state) {
     message_id_t message_id;
-    buffer.get(message_id, MESSAGE_ID_SIZE);
+    MessageIdLayout::get(buffer, message_id);
     type = static_cast<ClientMessageType>(message_id);
 
     switch (type) {
@@ -93,9 +95,10 @@ ClientMessage::ClientMessage(Buffer &buffer) {//, GameState &game_state) {
         }
         case ClientMessageType::PlaceBomb:
         case ClientMessageType::PlaceBlock:
+        case ClientMessageType::UseCompactEncoding:
             break;
         case ClientMessageType::Move: {
-            buffer.get(direction, DIRECTION_SIZE);
+            MoveLayout::get(buffer, direction);
             switch (static_cast<Direction>(direction)) {
                 case Direction::Up:
                 case Direction::Right:
@@ -114,19 +117,41 @@ ClientMessage::ClientMessage(Buffer &buffer) {//, GameState &game_state) {
     }
 }
 
+size_t ClientMessage::measure(const char *data, size_t available) {
+    if (available < MESSAGE_ID_SIZE) {
+        return 0;
+    }
+    size_t length = MESSAGE_ID_SIZE;
+    switch (static_cast<ClientMessageType>(data[0])) {
+        case ClientMessageType::Join:
+            if (available < MESSAGE_ID_SIZE + STRING_LENGTH_SIZE) {
+                return 0;
+            }
+            length += STRING_LENGTH_SIZE + (uint8_t) data[MESSAGE_ID_SIZE];
+            break;
+        case ClientMessageType::Move:
+            length += DIRECTION_SIZE;
+            break;
+        default:
+            break;
+    }
+    return length <= available ? length : 0;
+}
+
 // Inserts a ClientMessage message into buffer.
 void ClientMessage::insert_to_buffer(Buffer &buffer) const {
     auto message_id = static_cast<message_id_t>(type);
-    buffer.insert(message_id, MESSAGE_ID_SIZE);
 
     switch (type) {
         case ClientMessageType::Join:
+            MessageIdLayout::insert(buffer, message_id);
             buffer.insert(player_name);
             break;
         case ClientMessageType::Move:
-            buffer.insert(direction, DIRECTION_SIZE);
+            WithMessageId<MoveLayout>::insert(buffer, message_id, direction);
             break;
         default:
+            MessageIdLayout::insert(buffer, message_id);
             break;
     }
 }
@@ -134,23 +159,21 @@ void ClientMessage::insert_to_buffer(Buffer &buffer) const {
 // Gets a ServerMessage message from buffer and updates 'game_state' accordingly.
 ServerMessage::ServerMessage(Buffer &buffer, GameState &game_state) {
     message_id_t message_id;
-    buffer.get(message_id, MESSAGE_ID_SIZE);
+    MessageIdLayout::get(buffer, message_id);
     type = static_cast<ServerMessageType>(message_id);
 
     switch (type) {
         case ServerMessageType::Hello: {
             buffer.get(game_state.server_name);
-            buffer.get(game_state.players_count, PLAYERS_COUNT_SIZE);
-            buffer.get(game_state.size_x, COORDINATE_SIZE);
-            buffer.get(game_state.size_y, COORDINATE_SIZE);
-            buffer.get(game_state.game_length, GAME_LENGTH_SIZE);
-            buffer.get(game_state.explosion_radius, EXPLOSION_RADIUS_SIZE);
-            buffer.get(game_state.bomb_timer, BOMB_TIMER_SIZE);
+            GameParametersLayout::get(buffer, game_state.players_count, game_state.size_x,
+                                      game_state.size_y, game_state.game_length,
+                                      game_state.explosion_radius, game_state.bomb_timer);
+            game_state.resize_board();
             break;
         }
         case ServerMessageType::AcceptedPlayer: {
             player_id_t player_id;
-            buffer.get(player_id, PLAYER_ID_SIZE);
+            PlayerIdLayout::get(buffer, player_id);
             Player player(buffer);
 
             // Insert player to players and scores.
@@ -160,10 +183,10 @@ ServerMessage::ServerMessage(Buffer &buffer, GameState &game_state) {
         }
         case ServerMessageType::GameStarted: {
             list_length_t players_size;
-            buffer.get(players_size, LIST_LENGTH_SIZE);
+            ListLengthLayout::get(buffer, players_size);
             for (list_length_t i = 0; i < players_size; i++) {
                 player_id_t player_id;
-                buffer.get(player_id, PLAYER_ID_SIZE);
+                PlayerIdLayout::get(buffer, player_id);
                 Player player(buffer);
 
                 // Insert players to players and scores.
@@ -180,66 +203,25 @@ ServerMessage::ServerMessage(Buffer &buffer, GameState &game_state) {
             break;
         }
         case ServerMessageType::Turn: {
-            // Decrease all bombs' timers.
-            for (auto & [bomb_id, bomb]: game_state.bombs) {
-                bomb.decrease_timer();
-            }
-            // Clear explosions set.
-            game_state.explosions.clear();
-
-            buffer.get(game_state.turn, TURN_SIZE);
-
-            list_length_t events_size;
-            buffer.get(events_size, LIST_LENGTH_SIZE);
-            for (list_length_t i = 0; i < events_size; i++) {
-                event_type_t event_type;
-                buffer.get(event_type, EVENT_TYPE_SIZE);
-                switch (static_cast<EventType>(event_type)) {
-                    case EventType::BombPlaced: {
-                        BombPlaced bomb_placed(buffer);
-                        bomb_placed.execute(game_state);
-                        break;
-                    }
-                    case EventType::BombExploded: {
-                        BombExploded bomb_exploded(buffer);
-                        bomb_exploded.execute(game_state, robots_destroyed, blocks_destroyed);
-                        break;
-                    }
-                    case EventType::PlayerMoved: {
-                        PlayerMoved player_moved(buffer);
-                        player_moved.execute(game_state);
-                        break;
-                    }
-                    case EventType::BlockPlaced: {
-                        BlockPlaced block_placed(buffer);
-                        block_placed.execute(game_state);
-                        break;
-                    }
-                    default:
-                        break;
-                }
-            }
-
-            // Give a point to every player who died in this turn.
-            for (auto const & destroyed_player: robots_destroyed) {
-                game_state.scores[destroyed_player]++;
-            }
-
-            // Remove blocks destroyed in this turn.
-            for (auto const & destroyed_block: blocks_destroyed) {
-                game_state.blocks.erase(destroyed_block);
-            }
-
+            // Decode the whole message in place, directly from received bytes.
+            size_t length;
+            const char *data = buffer.take_message(TurnView::measure, length);
+            TurnView(data, length).apply(game_state);
+            break;
+        }
+        case ServerMessageType::CompactTurn: {
+            size_t length;
+            const char *data = buffer.take_message(CompactTurn::measure, length);
+            CompactTurn::apply(data, length, game_state);
             break;
         }
         case ServerMessageType::GameEnded: {
             list_length_t scores_size;
-            buffer.get(scores_size, LIST_LENGTH_SIZE);
+            ListLengthLayout::get(buffer, scores_size);
             for (list_length_t i = 0; i < scores_size; i++) {
                 player_id_t player_id;
-                buffer.get(player_id, PLAYER_ID_SIZE);
                 score_t score;
-                buffer.get(score, SCORE_SIZE);
+                PlayerScoreLayout::get(buffer, player_id, score);
 
                 // Update players' scores.
                 game_state.scores[player_id] = score;
@@ -271,46 +253,202 @@ ServerMessage::ServerMessage(Buffer &buffer, GameState &game_state) {
 // Inserts a ServerMessage message into buffer.
 void ServerMessage::insert_to_buffer(Buffer &buffer, GameState &game_state) const {
     auto message_id = static_cast<message_id_t>(type);
-    buffer.insert(message_id, MESSAGE_ID_SIZE);
 
     switch (type) {
         case ServerMessageType::Hello:
+            MessageIdLayout::insert(buffer, message_id);
             buffer.insert(game_state.server_name);
-            buffer.insert(game_state.players_count, PLAYERS_COUNT_SIZE);
-            buffer.insert(game_state.size_x, COORDINATE_SIZE);
-            buffer.insert(game_state.size_y, COORDINATE_SIZE);
-            buffer.insert(game_state.game_length, GAME_LENGTH_SIZE);
-            buffer.insert(game_state.explosion_radius, EXPLOSION_RADIUS_SIZE);
-            buffer.insert(game_state.bomb_timer, BOMB_TIMER_SIZE);
+            GameParametersLayout::insert(buffer, game_state.players_count, game_state.size_x,
+                                         game_state.size_y, game_state.game_length,
+                                         game_state.explosion_radius, game_state.bomb_timer);
             break;
         case ServerMessageType::AcceptedPlayer:
-            buffer.insert(accepted_player_id, PLAYER_ID_SIZE);
+            WithMessageId<PlayerIdLayout>::insert(buffer, message_id, accepted_player_id);
             accepted_player.insert_to_buffer(buffer);
             break;
         case ServerMessageType::GameStarted:
-            buffer.insert((list_length_t) players.size(), LIST_LENGTH_SIZE);
+            WithMessageId<ListLengthLayout>::insert(buffer, message_id,
+                                                    (list_length_t) players.size());
             for (auto const & [player_id, player]: players) {
-                buffer.insert(player_id, PLAYER_ID_SIZE);
+                PlayerIdLayout::insert(buffer, player_id);
                 player.insert_to_buffer(buffer);
             }
             break;
         case ServerMessageType::Turn:
-            buffer.insert(turn, TURN_SIZE);
-            buffer.insert((list_length_t) events.size(), LIST_LENGTH_SIZE);
-            for (auto const & event: events) {
-                event->insert_to_buffer(buffer);
-            }
+            WithMessageId<TurnLayout>::insert(buffer, message_id, turn,
+                                              (list_length_t) events->size());
+            events->insert_to_buffer(buffer);
             break;
         case ServerMessageType::GameEnded:
-            buffer.insert((list_length_t) scores.size(), LIST_LENGTH_SIZE);
-            for (auto const & [player_id, score]: scores) {
-                buffer.insert(player_id, PLAYER_ID_SIZE);
-                buffer.insert(score, SCORE_SIZE);
+            MessageIdLayout::insert(buffer, message_id);
+            insert_player_list_to_buffer(buffer, scores);
+            break;
+        case ServerMessageType::CompactTurn:
+            // Only encoded by EncodedMessage.
+            throw std::invalid_argument("CompactTurn message can't be inserted directly");
+    }
+}
+
+// Computes the length of a ServerMessage message when inserted into buffer.
+size_t ServerMessage::get_encoded_size(GameState &game_state) const {
+    size_t encoded_size = MESSAGE_ID_SIZE;
+    switch (type) {
+        case ServerMessageType::Hello:
+            encoded_size += STRING_LENGTH_SIZE + game_state.server_name.length() +
+                            GameParametersLayout::size;
+            break;
+        case ServerMessageType::AcceptedPlayer:
+            encoded_size += PlayerIdLayout::size + accepted_player.get_encoded_size();
+            break;
+        case ServerMessageType::GameStarted:
+            encoded_size += ListLengthLayout::size;
+            for (auto const & [player_id, player]: players) {
+                encoded_size += PlayerIdLayout::size + player.get_encoded_size();
             }
             break;
+        case ServerMessageType::Turn:
+            encoded_size += TurnLayout::size + events->get_encoded_size();
+            break;
+        case ServerMessageType::GameEnded:
+            encoded_size += ListLengthLayout::size + scores.size() * PlayerScoreLayout::size;
+            break;
+        case ServerMessageType::CompactTurn:
+            break;
+    }
+    return encoded_size;
+}
+
+// Encodes a ServerMessage message: computes its length first, then inserts it into a block of
+// exactly this length.
+EncodedMessage::EncodedMessage(const ServerMessage &server_message, GameState &game_state) :
+        type(server_message.get_type()), length(server_message.get_encoded_size(game_state)) {
+    bytes = FramePool::get_instance().acquire(length, block_class);
+    try {
+        BufferFixed buffer(bytes, length);
+        server_message.insert_to_buffer(buffer, game_state);
+        if (buffer.get_message_length() != length) {
+            throw std::length_error("Message shorter than its computed length");
+        }
+    } catch (...) {
+        FramePool::get_instance().release(bytes, block_class);
+        throw;
+    }
+}
+
+namespace {
+    constexpr size_t TURN_HEADER_LENGTH = MESSAGE_ID_SIZE + TurnLayout::size;
+
+    // Calls 'on_event' with the beginning and the length of every event of an encoded Turn
+    // message.
+    template <typename OnEvent>
+    void for_each_event(const char *bytes, OnEvent &&on_event) {
+        list_length_t events_count;
+        load(bytes + MESSAGE_ID_SIZE + TURN_SIZE, events_count);
+        const char *event = bytes + TURN_HEADER_LENGTH;
+        for (list_length_t i = 0; i < events_count; i++) {
+            size_t event_length = EventView::measure(event, SIZE_MAX);
+            on_event(event, event_length);
+            event += event_length;
+        }
     }
 }
 
+EncodedMessage::EncodedMessage(std::span<const EncodedMessage *const> turns) :
+        type(ServerMessageType::Turn), length(TURN_HEADER_LENGTH) {
+    if (turns.empty()) {
+        throw std::invalid_argument("No Turn messages to coalesce");
+    }
+    // Index (among events of all turns) of the last move of every robot in turns but the last.
+    std::array<size_t, PLAYERS_COUNT_MAX + 1> last_moves;
+    last_moves.fill(SIZE_MAX);
+    size_t event_index = 0;
+    size_t dropped_moves = 0;
+    turn_t turn = 0;
+    size_t events_count = 0;
+    for (size_t i = 0; i < turns.size(); i++) {
+        const EncodedMessage *message = turns[i];
+        if (message->type != ServerMessageType::Turn) {
+            throw std::invalid_argument("Only Turn messages can be coalesced");
+        }
+        if (i + 1 < turns.size()) {
+            if (!message->can_precede_turn()) {
+                throw std::invalid_argument("Turn message can't precede another one");
+            }
+            for_each_event(message->bytes, [&](const char *event, size_t) {
+                EventView event_view(event);
+                if (event_view.get_type() == EventType::PlayerMoved) {
+                    size_t &last_move = last_moves[event_view.get_player_id()];
+                    dropped_moves += last_move != SIZE_MAX;
+                    last_move = event_index;
+                }
+                event_index++;
+            });
+        }
+        message_id_t message_id;
+        list_length_t message_events_count;
+        BufferFixed header(message->bytes, TURN_HEADER_LENGTH);
+        WithMessageId<TurnLayout>::get(header, message_id, turn, message_events_count);
+        events_count += message_events_count;
+        length += message->length - TURN_HEADER_LENGTH;
+    }
+    events_count -= dropped_moves;
+    length -= dropped_moves * PlayerMoved::ENCODED_SIZE;
+    if (events_count > std::numeric_limits<list_length_t>::max()) {
+        throw std::length_error("Too many events to coalesce");
+    }
+    bytes = FramePool::get_instance().acquire(length, block_class);
+    BufferFixed buffer(bytes, TURN_HEADER_LENGTH);
+    WithMessageId<TurnLayout>::insert(buffer, static_cast<message_id_t>(type), turn,
+                                      (list_length_t) events_count);
+    // Events are encoded the same in every turn, so they are copied as they are.
+    char *events = bytes + TURN_HEADER_LENGTH;
+    event_index = 0;
+    for (size_t i = 0; i + 1 < turns.size(); i++) {
+        for_each_event(turns[i]->bytes, [&](const char *event, size_t event_length) {
+            EventView event_view(event);
+            if (event_view.get_type() != EventType::PlayerMoved ||
+                last_moves[event_view.get_player_id()] == event_index) {
+                memcpy(events, event, event_length);
+                events += event_length;
+            }
+            event_index++;
+        });
+    }
+    const EncodedMessage *last_turn = turns.back();
+    memcpy(events, last_turn->bytes + TURN_HEADER_LENGTH, last_turn->length - TURN_HEADER_LENGTH);
+}
+
+bool EncodedMessage::can_precede_turn() const {
+    if (type != ServerMessageType::Turn) {
+        return false;
+    }
+    bool only_moves = true;
+    for_each_event(bytes, [&](const char *event, size_t) {
+        EventType event_type = EventView(event).get_type();
+        only_moves &= event_type == EventType::PlayerMoved || event_type == EventType::BlockPlaced;
+    });
+    return only_moves;
+}
+
+bool EncodedMessage::has_compact_encoding() const {
+    if (type != ServerMessageType::Turn) {
+        return false;
+    }
+    std::call_once(compact_encoded, [this] {
+        // Length of the compact encoding isn't known before encoding the message.
+        thread_local BufferMemory buffer;
+        buffer.clear();
+        TurnView turn_view(bytes + MESSAGE_ID_SIZE, length - MESSAGE_ID_SIZE);
+        if (CompactTurn::insert_to_buffer(buffer, turn_view)) {
+            compact_length = buffer.get_message_length();
+            compact_bytes = FramePool::get_instance().acquire(compact_length,
+                                                             compact_block_class);
+            memcpy(compact_bytes, buffer.get_data(), compact_length);
+        }
+    });
+    return compact_bytes != nullptr;
+}
+
 // Creates an answer for the ServerMessage message.
 DrawMessage::DrawMessage(ServerMessage server_message, [[maybe_unused]] GameState &game_state) {
     switch (server_message.get_type()) {
@@ -320,6 +458,7 @@ DrawMessage::DrawMessage(ServerMessage server_message, [[maybe_unused]] GameStat
             type = DrawMessageType::Lobby;
             break;
         case ServerMessageType::Turn:
+        case ServerMessageType::CompactTurn:
             type = DrawMessageType::Game;
             break;
         default:
@@ -330,63 +469,45 @@ DrawMessage::DrawMessage(ServerMessage server_message, [[maybe_unused]] GameStat
 // Inserts a DrawMessage message into buffer.
 void DrawMessage::insert_to_buffer(Buffer &buffer, GameState &game_state) const {
     auto message_id = static_cast<message_id_t>(type);
-    buffer.insert(message_id, MESSAGE_ID_SIZE);
 
     switch (type) {
         case DrawMessageType::Lobby:
+            MessageIdLayout::insert(buffer, message_id);
             buffer.insert(game_state.server_name);
-            buffer.insert(game_state.players_count, PLAYERS_COUNT_SIZE);
-            buffer.insert(game_state.size_x, COORDINATE_SIZE);
-            buffer.insert(game_state.size_y, COORDINATE_SIZE);
-            buffer.insert(game_state.game_length, GAME_LENGTH_SIZE);
-            buffer.insert(game_state.explosion_radius, EXPLOSION_RADIUS_SIZE);
-            buffer.insert(game_state.bomb_timer, BOMB_TIMER_SIZE);
-
-            buffer.insert((list_length_t) game_state.players.size(), LIST_LENGTH_SIZE);
+            GameParametersLayout::insert(buffer, game_state.players_count, game_state.size_x,
+                                         game_state.size_y, game_state.game_length,
+                                         game_state.explosion_radius, game_state.bomb_timer);
+
+            ListLengthLayout::insert(buffer, (list_length_t) game_state.players.size());
             for (auto const & [player_id, player]: game_state.players) {
-                buffer.insert(player_id, PLAYER_ID_SIZE);
+                PlayerIdLayout::insert(buffer, player_id);
                 player.insert_to_buffer(buffer);
             }
             break;
         case DrawMessageType::Game:
+            MessageIdLayout::insert(buffer, message_id);
             buffer.insert(game_state.server_name);
-            buffer.insert(game_state.size_x, COORDINATE_SIZE);
-            buffer.insert(game_state.size_y, COORDINATE_SIZE);
-            buffer.insert(game_state.game_length, GAME_LENGTH_SIZE);
-            buffer.insert(game_state.turn, TURN_SIZE);
+            DrawGameLayout::insert(buffer, game_state.size_x, game_state.size_y,
+                                   game_state.game_length, game_state.turn);
 
-            buffer.insert((list_length_t) game_state.players.size(), LIST_LENGTH_SIZE);
+            ListLengthLayout::insert(buffer, (list_length_t) game_state.players.size());
             for (auto const & [player_id, player]: game_state.players) {
-                buffer.insert(player_id, PLAYER_ID_SIZE);
+                PlayerIdLayout::insert(buffer, player_id);
                 player.insert_to_buffer(buffer);
             }
 
-            buffer.insert((list_length_t) game_state.player_positions.size(), LIST_LENGTH_SIZE);
-            for (auto const & [player_id, position]: game_state.player_positions) {
-                buffer.insert(player_id, PLAYER_ID_SIZE);
-                position.insert_to_buffer(buffer);
-            }
+            insert_player_list_to_buffer(buffer, game_state.player_positions);
 
-            buffer.insert((list_length_t) game_state.blocks.size(), LIST_LENGTH_SIZE);
-            for (auto const & block: game_state.blocks) {
-                block.insert_to_buffer(buffer);
-            }
+            Position::insert_list_to_buffer(buffer, game_state.blocks);
 
-            buffer.insert((list_length_t) game_state.bombs.size(), LIST_LENGTH_SIZE);
+            ListLengthLayout::insert(buffer, (list_length_t) game_state.bombs.size());
             for (auto const & bomb: game_state.bombs) {
-                bomb.second.insert_to_buffer(buffer);
+                bomb.second.insert_to_buffer(buffer, game_state.turn);
             }
 
-            buffer.insert((list_length_t) game_state.explosions.size(), LIST_LENGTH_SIZE);
-            for (auto const & explosion: game_state.explosions) {
-                explosion.insert_to_buffer(buffer);
-            }
+            Position::insert_list_to_buffer(buffer, game_state.explosions);
 
-            buffer.insert((list_length_t) game_state.scores.size(), LIST_LENGTH_SIZE);
-            for (auto const & [player_id, score]: game_state.scores) {
-                buffer.insert(player_id, PLAYER_ID_SIZE);
-                buffer.insert(score, SCORE_SIZE);
-            }
+            insert_player_list_to_buffer(buffer, game_state.scores);
             break;
         default:
             break;
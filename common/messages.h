@@ -1,8 +1,12 @@
 #ifndef MESSAGES_H
 #define MESSAGES_H
 
+#include <memory>
+#include <mutex>
+#include <span>
 #include <utility>
 #include "events.h"
+#include "frame_pool.h"
 
 enum class Direction : direction_t {
     Up = 0,
@@ -21,7 +25,8 @@ enum class ClientMessageType : message_id_t {
     Join = 0,
     PlaceBomb = 1,
     PlaceBlock = 2,
-    Move = 3
+    Move = 3,
+    UseCompactEncoding = 4 // Asks the server to send Turn messages as CompactTurn messages.
 };
 
 class InputMessage {
@@ -52,11 +57,19 @@ private:
 
 public:
     ClientMessage() = default;
+    // Constructor of messages without parameters.
+    explicit ClientMessage(ClientMessageType type) : type(type) {}
+    // Constructor of a Move message.
+    explicit ClientMessage(Direction direction) :
+            type(ClientMessageType::Move), direction(static_cast<direction_t>(direction)) {}
     explicit ClientMessage(InputMessage input_message, GameState &game_state,
                            std::string name);
     explicit ClientMessage(Buffer &buffer);
     void insert_to_buffer(Buffer &buffer) const;
-    ClientMessageType get_type() {
+    // Returns the length of a message whose first 'available' bytes are at 'data', or 0 if more
+    // bytes are needed to tell it. Messages of unknown types are one byte long.
+    static size_t measure(const char *data, size_t available);
+    [[nodiscard]] ClientMessageType get_type() const {
         return type;
     }
     [[nodiscard]] direction_t get_direction() const {
@@ -65,17 +78,44 @@ public:
     [[nodiscard]] bool is_correct() const {
         return correct;
     }
-    std::string get_player_name() {
+    [[nodiscard]] const std::string &get_player_name() const {
         return player_name;
     }
 };
 
+// Game message of a player (PlaceBomb, PlaceBlock or Move) packed in two bytes, so that the
+// newest one is stored and taken with single atomic operations. An empty input means that player
+// didn't send a message.
+class PlayerInput {
+private:
+    static constexpr message_id_t NO_MESSAGE = UINT8_MAX;
+
+    message_id_t type = NO_MESSAGE;
+    direction_t direction = 0; // For Move message.
+
+public:
+    PlayerInput() = default;
+    explicit PlayerInput(const ClientMessage &client_message) :
+            type(static_cast<message_id_t>(client_message.get_type())),
+            direction(client_message.get_direction()) {}
+    [[nodiscard]] bool empty() const {
+        return type == NO_MESSAGE;
+    }
+    [[nodiscard]] ClientMessageType get_type() const {
+        return static_cast<ClientMessageType>(type);
+    }
+    [[nodiscard]] direction_t get_direction() const {
+        return direction;
+    }
+};
+
 enum class ServerMessageType : message_id_t {
     Hello = 0,
     AcceptedPlayer = 1,
     GameStarted = 2,
     Turn = 3,
-    GameEnded = 4
+    GameEnded = 4,
+    CompactTurn = 5 // Turn message in the compact encoding (see compact.h).
 };
 
 class ServerMessage {
@@ -86,9 +126,7 @@ private:
     Player accepted_player; // For PlayerAccepted message.
     std::map<player_id_t, Player> players; // For GameStarted message.
     turn_t turn{}; // For Turn message.
-    std::set<player_id_t> robots_destroyed; // For Turn message.
-    std::set<Position> blocks_destroyed; // For Turn message.
-    std::vector<std::shared_ptr<Event>> events; // For Turn message.
+    const TurnEvents *events = nullptr; // For Turn message (kept by its sender until encoded).
     std::map<player_id_t, score_t> scores; // For GameEnded message.
 
 public:
@@ -106,13 +144,14 @@ public:
             type(type), players(game_state.players), scores(game_state.scores) {}
 
     // Turn message constructor.
-    explicit ServerMessage(ServerMessageType type, turn_t turn,
-                           std::vector<std::shared_ptr<Event>> events) :
-            type(type), turn(turn), events(std::move(events)) {}
+    explicit ServerMessage(ServerMessageType type, turn_t turn, const TurnEvents &events) :
+            type(type), turn(turn), events(&events) {}
 
     explicit ServerMessage(Buffer &buffer, GameState &game_state);
     void insert_to_buffer(Buffer &buffer, GameState &game_state) const;
-    ServerMessageType get_type() {
+    // Returns the number of bytes inserted by 'insert_to_buffer'.
+    [[nodiscard]] size_t get_encoded_size(GameState &game_state) const;
+    [[nodiscard]] ServerMessageType get_type() const {
         return type;
     }
     [[nodiscard]] bool should_send_message_to_gui() const {
@@ -120,6 +159,74 @@ public:
     }
 };
 
+// ServerMessage encoded once. The same (immutable) bytes are shared by all client connections
+// it is sent to, including clients joining later and receiving past messages. They are kept in
+// a single block of memory of exactly computed length, taken from FramePool.
+// Turn messages can also be sent in the compact encoding. It is computed (from the encoded Turn
+// message) only when the first client which opted in to it sends the message, and shared in
+// the same way.
+class EncodedMessage {
+private:
+    ServerMessageType type;
+    char *bytes;
+    size_t length;
+    size_t block_class{};
+    mutable std::once_flag compact_encoded;
+    mutable char *compact_bytes = nullptr;
+    mutable size_t compact_length{};
+    mutable size_t compact_block_class{};
+
+    // Returns true if the message has the compact encoding (and computes it if needed).
+    bool has_compact_encoding() const;
+
+public:
+    explicit EncodedMessage(const ServerMessage &server_message, GameState &game_state);
+    // Joins consecutive Turn messages into one Turn message, with the number of the last turn
+    // and events of all of them in order. It is sent to a client which fell behind, to catch up
+    // with fewer messages, so it has to leave the client in the same state as the separate
+    // ones: every turn but the last has to precede another one (see 'can_precede_turn'), which
+    // is checked. Of moves of a robot in those turns only the last one is kept. If the last
+    // turn has explosions, they don't precede all other events, so the message is sent in the
+    // standard encoding only.
+    explicit EncodedMessage(std::span<const EncodedMessage *const> turns);
+    EncodedMessage(const EncodedMessage &) = delete;
+    // Encodes a message into a shared EncodedMessage. Like its bytes, the object itself (with
+    // the control block of the pointer) is kept in a block from FramePool.
+    static std::shared_ptr<const EncodedMessage> create(const ServerMessage &server_message,
+                                                        GameState &game_state) {
+        return std::allocate_shared<EncodedMessage>(FramePoolAllocator<EncodedMessage>(),
+                                                    server_message, game_state);
+    }
+    static std::shared_ptr<const EncodedMessage> coalesce_turns(
+            std::span<const EncodedMessage *const> turns) {
+        return std::allocate_shared<EncodedMessage>(FramePoolAllocator<EncodedMessage>(), turns);
+    }
+    EncodedMessage &operator=(const EncodedMessage &) = delete;
+    ~EncodedMessage() {
+        FramePool::get_instance().release(bytes, block_class);
+        if (compact_bytes != nullptr) {
+            FramePool::get_instance().release(compact_bytes, compact_block_class);
+        }
+    }
+
+    [[nodiscard]] ServerMessageType get_type() const {
+        return type;
+    }
+    // Returns true if the message is a Turn message with PlayerMoved and BlockPlaced events only.
+    // They don't depend on the number of the turn (unlike BombPlaced events) and the client
+    // doesn't clear their effects at the next turn (unlike those of BombExploded events), so
+    // they can be applied at the beginning of the next turn instead.
+    [[nodiscard]] bool can_precede_turn() const;
+    // Returns the bytes sent to a client, in the compact encoding if the client opted in to it
+    // and the message has one.
+    [[nodiscard]] const char *get_data(bool compact = false) const {
+        return compact && has_compact_encoding() ? compact_bytes : bytes;
+    }
+    [[nodiscard]] size_t get_length(bool compact = false) const {
+        return compact && has_compact_encoding() ? compact_length : length;
+    }
+};
+
 enum class DrawMessageType : message_id_t {
     Lobby = 0,
     Game = 1,
@@ -2,8 +2,11 @@
 #define PROGRAM_OPTIONS_H
 
 #include <boost/program_options.hpp>
+#include <algorithm>
 #include <string>
 #include <stdexcept>
+#include <thread>
+#include "bitboard.h"
 #include "types.h"
 
 namespace po = boost::program_options;
@@ -24,7 +27,11 @@ po::options_description get_client_options_description() {
     )("port,p", po::value<port_parsing_t>()->required(),
         "Port on which the client is listening for messages from GUI"
     )("server-address,s", po::value<std::string>()->required(),
-        "Address of the game server <(host name):(port) or (IPv4):(port) or (IPv6):(port)>");
+        "Address of the game server <(host name):(port) or (IPv4):(port) or (IPv6):(port)>"
+    )("compact-encoding", po::bool_switch(),
+        "Ask the server for the compact encoding of Turn messages"
+    )("statistics", po::bool_switch(),
+        "Print performance statistics to standard error");
 
     return client_options_description;
 }
@@ -42,6 +49,13 @@ po::options_description get_server_options_description() {
         "Duration of one turn in milliseconds"
     )("explosion-radius,e", po::value<explosion_radius_parsing_t>()->required(),
         "Radius of bomb explosions"
+    )("explosion-engine", po::value<std::string>()->default_value("bitboard"),
+        "Way of calculating explosions: bitboard (on boards of up to 2^24 fields), extents (on "
+        "boards of up to 2^22 fields) or reference"
+    )("explosion-threads", po::value<explosion_threads_parsing_t>()->default_value(1),
+        "Number of threads calculating explosions of bombs exploding in the same turn"
+    )("action-threads", po::value<action_threads_parsing_t>()->default_value(1),
+        "Number of threads evaluating actions of players in a turn (for rooms with many players)"
     )("initial-blocks,k", po::value<initial_blocks_parsing_t>()->required(),
         "Initial number of blocks on the board"
     )("game-length,l", po::value<game_length_parsing_t>()->required(),
@@ -50,12 +64,40 @@ po::options_description get_server_options_description() {
         "Name of the server"
     )("port,p", po::value<port_parsing_t>()->required(),
         "Port on which the server is listening for messages from clients"
+    )("network-threads", po::value<network_threads_parsing_t>()->default_value(0),
+        "Number of threads serving all connections with asynchronous reads and writes (0 "
+        "serves every connection with its own two threads)"
+    )("max-connections", po::value<max_connections_parsing_t>()->default_value(1024),
+        "Maximum number of open connections, further ones are closed right after accepting"
+    )("send-batch-bytes", po::value<send_batch_bytes_parsing_t>()->default_value(65536),
+        "Maximum number of bytes of queued messages sent to a client with one write"
+    )("max-queued-messages", po::value<max_queued_messages_parsing_t>()->default_value(0),
+        "Maximum number of messages waiting to be sent to a client, over which the slow client "
+        "policy applies (0 for no limit)"
+    )("max-queued-bytes", po::value<max_queued_bytes_parsing_t>()->default_value(0),
+        "Maximum number of bytes of messages waiting to be sent to a client, over which the slow "
+        "client policy applies (0 for no limit)"
+    )("slow-client-policy", po::value<std::string>()->default_value("disconnect"),
+        "What happens to a client over the limit of queued messages: disconnect or coalesce "
+        "(queued Turn messages into fewer equivalent ones, disconnecting the client once it is "
+        "4 times over the limit)"
+    )("rooms", po::value<rooms_parsing_t>()->default_value(1),
+        "Number of rooms, each hosting its own game (with the seed increased by the number of "
+        "the room)"
+    )("room-threads", po::value<room_threads_parsing_t>()->default_value(
+            (room_threads_parsing_t) std::max(std::thread::hardware_concurrency(), 1U)),
+        "Number of threads running turns of all rooms (default is the number of cores)"
+    )("spin-wait", po::value<spin_wait_parsing_t>()->default_value(0),
+        "Number of microseconds before the start of a turn spent spinning instead of sleeping, "
+        "so that turns start on time"
     )("seed,s", po::value<seed_parsing_t>()->default_value(0),
         "Seed to be used for generating random values (default value is 0)"
     )("size-x,x", po::value<coordinate_parsing_t>()->required(),
         "Horizontal size of the board"
     )("size-y,y", po::value<coordinate_parsing_t>()->required(),
-        "Vertical size of the board");
+        "Vertical size of the board"
+    )("statistics", po::bool_switch(),
+        "Print performance statistics to standard error");
 
     return server_options_description;
 }
@@ -105,6 +147,17 @@ uint64_t parse(const std::string &string, const std::string &option) {
     return (uint64_t) value;
 }
 
+ExplosionEngine parse_explosion_engine(const std::string &string, const std::string &option) {
+    if (string == "bitboard") {
+        return ExplosionEngine::Bitboard;
+    } else if (string == "extents") {
+        return ExplosionEngine::Extents;
+    } else if (string != "reference") {
+        throw_parsing_error(string, option);
+    }
+    return ExplosionEngine::Reference;
+}
+
 void notify_variables_map(po::variables_map &variables_map) {
     po::notify(variables_map);
 }
@@ -0,0 +1,146 @@
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include <arpa/inet.h>
+#include "buffer.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Compile-time description of the wire format. Every fixed-size run of fields of a message is
+// declared once as a Layout, which encodes and decodes the whole run with a single bounds check
+// of buffer and sizes known at compile time.
+
+// Field sent on SIZE bytes in network byte order and kept in a variable of type T.
+template <typename T, size_t SIZE>
+struct Field {
+    static_assert(sizeof(T) == SIZE, "Field size has to match the size of its type");
+    using type = T;
+    static constexpr size_t size = SIZE;
+};
+
+using MessageIdField = Field<message_id_t, MESSAGE_ID_SIZE>;
+using EventTypeField = Field<event_type_t, EVENT_TYPE_SIZE>;
+using DirectionField = Field<direction_t, DIRECTION_SIZE>;
+using ListLengthField = Field<list_length_t, LIST_LENGTH_SIZE>;
+using PlayersCountField = Field<players_count_t, PLAYERS_COUNT_SIZE>;
+using GameLengthField = Field<game_length_t, GAME_LENGTH_SIZE>;
+using ExplosionRadiusField = Field<explosion_radius_t, EXPLOSION_RADIUS_SIZE>;
+using BombTimerField = Field<bomb_timer_t, BOMB_TIMER_SIZE>;
+using BombIdField = Field<bomb_id_t, BOMB_ID_SIZE>;
+using PlayerIdField = Field<player_id_t, PLAYER_ID_SIZE>;
+using ScoreField = Field<score_t, SCORE_SIZE>;
+using TurnField = Field<turn_t, TURN_SIZE>;
+using CoordinateField = Field<coordinate_t, COORDINATE_SIZE>;
+
+// Functions converting a value between host and network byte order.
+inline uint8_t swap_network_byte_order(uint8_t value) {
+    return value;
+}
+
+inline uint16_t swap_network_byte_order(uint16_t value) {
+    return htons(value);
+}
+
+inline uint32_t swap_network_byte_order(uint32_t value) {
+    return htonl(value);
+}
+
+inline uint64_t swap_network_byte_order(uint64_t value) {
+    return htobe64(value);
+}
+
+// Converts 'count' consecutive 16-bit values at 'data' between host and network byte order,
+// 8 of them at once with SSE2 instructions where available (always on x86-64).
+inline void swap_network_byte_order_16(char *data, size_t count) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 8 <= count; i += 8) {
+        auto *values = (__m128i *) (data + 2 * i);
+        __m128i value = _mm_loadu_si128(values);
+        _mm_storeu_si128(values, _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8)));
+    }
+#endif
+    for (; i < count; i++) {
+        uint16_t value;
+        memcpy(&value, data + 2 * i, sizeof(value));
+        value = __builtin_bswap16(value);
+        memcpy(data + 2 * i, &value, sizeof(value));
+    }
+#else
+    (void) data;
+    (void) count;
+#endif
+}
+
+// Functions storing a value at 'data' in network byte order and loading it from there.
+template <typename T>
+inline void store(char *data, T value) {
+    value = swap_network_byte_order(value);
+    memcpy(data, &value, sizeof(T));
+}
+
+template <typename T>
+inline void load(const char *data, T &value) {
+    memcpy(&value, data, sizeof(T));
+    value = swap_network_byte_order(value);
+}
+
+// Fixed-size run of fields, encoded one after another.
+template <typename... Fields>
+struct Layout {
+    static constexpr size_t size = (Fields::size + ...);
+
+    static void insert(Buffer &buffer, typename Fields::type... values) {
+        char *data = buffer.reserve(size);
+        ((store(data, values), data += Fields::size), ...);
+    }
+
+    static void get(Buffer &buffer, typename Fields::type &... values) {
+        const char *data = buffer.take(size);
+        ((load(data, values), data += Fields::size), ...);
+    }
+};
+
+// Layout of 'L' preceded by field 'F' (e.g. an event preceded by its type).
+template <typename F, typename L>
+struct Prefixed;
+
+template <typename F, typename... Fields>
+struct Prefixed<F, Layout<Fields...>> {
+    using type = Layout<F, Fields...>;
+};
+
+template <typename L>
+using WithMessageId = typename Prefixed<MessageIdField, L>::type;
+
+template <typename L>
+using WithEventType = typename Prefixed<EventTypeField, L>::type;
+
+// Common parts of messages.
+using PositionLayout = Layout<CoordinateField, CoordinateField>;
+using BombLayout = Layout<CoordinateField, CoordinateField, BombTimerField>;
+using PlayerIdLayout = Layout<PlayerIdField>;
+using PlayerPositionLayout = Layout<PlayerIdField, CoordinateField, CoordinateField>;
+using PlayerScoreLayout = Layout<PlayerIdField, ScoreField>;
+using ListLengthLayout = Layout<ListLengthField>;
+using MessageIdLayout = Layout<MessageIdField>;
+using EventTypeLayout = Layout<EventTypeField>;
+// Game parameters following the server name in Hello and Lobby messages.
+using GameParametersLayout = Layout<PlayersCountField, CoordinateField, CoordinateField,
+                                    GameLengthField, ExplosionRadiusField, BombTimerField>;
+
+// Events (without the event type).
+using BombPlacedLayout = Layout<BombIdField, CoordinateField, CoordinateField>;
+using BombExplodedLayout = Layout<BombIdField, ListLengthField>; // Followed by lists.
+using PlayerMovedLayout = PlayerPositionLayout;
+using BlockPlacedLayout = PositionLayout;
+
+// Messages (without the message id).
+using MoveLayout = Layout<DirectionField>;
+using TurnLayout = Layout<TurnField, ListLengthField>; // Followed by events.
+using DrawGameLayout = Layout<CoordinateField, CoordinateField, GameLengthField,
+                              TurnField>; // Follows the server name.
+
+#endif //SCHEMA_H
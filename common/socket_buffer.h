@@ -0,0 +1,129 @@
+#ifndef SOCKET_BUFFER_H
+#define SOCKET_BUFFER_H
+
+#include <utility> // Needed by Boost.Asio headers on newer compilers.
+#include <boost/asio.hpp>
+#include "buffer.h"
+
+namespace as = boost::asio;
+
+// Buffers of messages sent and received through sockets. They are kept apart from buffer.h, so
+// that the game engine (robots-core) doesn't depend on networking.
+
+class BufferUDP : public Buffer {
+private:
+    as::ip::udp::socket &socket;
+    as::ip::udp::endpoint endpoint;
+
+    void receive_message([[maybe_unused]] size_t value_size) override {
+        // Message fits in a UDP datagram, so load the whole message immediately
+        // (the argument is a dummy).
+        reset();
+        message_length = socket.receive(as::buffer(buffer, size));
+    }
+
+    void free(size_t value_size) override {
+        // Message has to fit in a UDP datagram.
+        if (index + value_size > size) {
+            throw std::length_error("Message too long for a UDP datagram");
+        }
+    }
+
+public:
+    BufferUDP(as::ip::udp::socket &socket, as::ip::udp::endpoint endpoint) :
+            Buffer(UDP_BUFFER_SIZE), socket(socket), endpoint(std::move(endpoint)) {}
+
+    void receive_message() {
+        receive_message(size);
+    }
+
+    void send_message() override {
+        socket.send_to(as::buffer(buffer, index), endpoint);
+        reset();
+    }
+};
+
+class BufferTCP : public Buffer {
+private:
+    as::ip::tcp::socket &socket;
+    // Receiving statistics.
+    uint64_t read_syscalls = 0;
+    uint64_t messages_received = 0;
+
+    void receive_message(size_t value_size) override {
+        // Read whatever the socket has (but at least 'value_size' bytes) after the bytes
+        // already kept in buffer.
+        while (value_size > 0) {
+            boost::system::error_code error;
+            size_t received = socket.read_some(
+                    as::buffer(buffer + message_length, size - message_length), error);
+            read_syscalls++;
+            if (error == as::error::eof) {
+                throw std::invalid_argument("Connection closed cleanly by peer");
+            } else if (error) {
+                throw boost::system::system_error(error);
+            }
+            message_length += received;
+            value_size -= std::min(value_size, received);
+        }
+    }
+
+    void fill(size_t value_size) override {
+        // With TCP, bytes between 'index' and 'message_length' were already read from the
+        // socket (read ahead). Serve the value from them if possible. Otherwise move them
+        // (there are fewer than 'value_size' of them) to the beginning of the buffer and
+        // read the missing ones, so that a value split across reads is kept contiguous.
+        if (index + value_size <= message_length) {
+            return;
+        }
+        size_t unread = message_length - index;
+        memmove(buffer, buffer + index, unread);
+        index = 0;
+        message_length = unread;
+        // Grow the buffer (at least twice) if the value won't fit in it.
+        if (value_size > size) {
+            grow(std::max(2 * size, value_size));
+        }
+        receive_message(value_size - unread);
+    }
+
+    void free(size_t value_size) override {
+        // Grow the buffer (at least twice) if given variable won't fit in it, so that every
+        // message is sent with exactly one write.
+        if (index + value_size > size) {
+            grow(std::max(2 * size, index + value_size));
+        }
+    }
+
+public:
+    explicit BufferTCP(as::ip::tcp::socket &socket) :
+            Buffer(TCP_BUFFER_SIZE), socket(socket) {}
+
+    void send_message() override {
+        as::write(socket, as::buffer(buffer, index));
+        reset();
+    }
+
+    // Marks that a whole message was received, for statistics.
+    void count_received_message() {
+        messages_received++;
+    }
+
+    [[nodiscard]] uint64_t get_read_syscalls() const {
+        return read_syscalls;
+    }
+
+    [[nodiscard]] uint64_t get_messages_received() const {
+        return messages_received;
+    }
+
+    // Writes receiving statistics to 'stream'.
+    void print_statistics(std::ostream &stream, const std::string &peer) const {
+        stream << peer << ": " << messages_received << " messages received with "
+               << read_syscalls << " read syscalls ("
+               << (messages_received > 0 ? (double) read_syscalls / (double) messages_received : 0)
+               << " per message)\n";
+    }
+};
+
+#endif //SOCKET_BUFFER_H
@@ -0,0 +1,78 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t size) : errors(std::max(size, (size_t) 1)) {
+    for (size_t part = 1; part < errors.size(); part++) {
+        threads.emplace_back(&ThreadPool::run_thread, this, part);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+    }
+    job_started.notify_all();
+    for (auto & thread: threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::run_thread(size_t part) {
+    uint64_t jobs_run = 0;
+    while (true) {
+        bool has_part;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            job_started.wait(lock, [&] { return stopped || jobs != jobs_run; });
+            if (stopped) {
+                return;
+            }
+            jobs_run = jobs;
+            has_part = part < parts;
+        }
+        if (has_part) {
+            try {
+                run_part(job, part);
+            } catch (...) {
+                errors[part] = std::current_exception();
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            threads_working--;
+        }
+        job_finished.notify_one();
+    }
+}
+
+void ThreadPool::run(size_t job_parts, void (*job_run_part)(void *, size_t), void *job_data) {
+    job_parts = std::clamp(job_parts, (size_t) 1, size());
+    std::fill(errors.begin(), errors.end(), nullptr);
+    if (job_parts > 1) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            parts = job_parts;
+            run_part = job_run_part;
+            job = job_data;
+            jobs++;
+            threads_working = threads.size();
+        }
+        job_started.notify_all();
+    }
+    try {
+        job_run_part(job_data, 0);
+    } catch (...) {
+        errors[0] = std::current_exception();
+    }
+    if (job_parts > 1) {
+        std::unique_lock<std::mutex> lock(mutex);
+        job_finished.wait(lock, [&] { return threads_working == 0; });
+    }
+    for (auto const & error: errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Threads running parts of a job at once. The calling thread runs part 0 and waits for the
+// other parts, run by threads of the pool, so a job of one part runs on the calling thread
+// only. Exceptions thrown by parts are rethrown by the calling thread.
+class ThreadPool {
+private:
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors; // Of every part.
+    std::mutex mutex;
+    std::condition_variable job_started;
+    std::condition_variable job_finished;
+    uint64_t jobs = 0; // Number of jobs started.
+    size_t threads_working = 0;
+    bool stopped = false;
+    // The current job.
+    size_t parts = 0;
+    void (*run_part)(void *job, size_t part) = nullptr;
+    void *job = nullptr;
+
+    void run_thread(size_t part);
+    void run(size_t job_parts, void (*job_run_part)(void *, size_t), void *job_data);
+
+public:
+    // Makes a pool running jobs of up to 'size' parts (so with 'size' - 1 threads).
+    explicit ThreadPool(size_t size);
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ~ThreadPool();
+
+    // Returns the maximal number of parts of a job.
+    [[nodiscard]] size_t size() const {
+        return threads.size() + 1;
+    }
+
+    // Calls 'run_part(part)' for every part from 0 to 'job_parts' - 1 (at most 'size()') at
+    // once, and returns when all of them returned.
+    template <typename RunPart>
+    void run(size_t job_parts, RunPart &&run_part) {
+        run(job_parts, [](void *job_data, size_t part) {
+            (*static_cast<std::remove_reference_t<RunPart> *>(job_data))(part);
+        }, &run_part);
+    }
+};
+
+#endif //THREAD_POOL_H
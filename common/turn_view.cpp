@@ -0,0 +1,165 @@
+#include "turn_view.h"
+
+#include <bitset>
+
+EventView::EventView(const char *event) : data(event + EVENT_TYPE_SIZE) {
+    event_type_t event_type;
+    load(event, event_type);
+    type = static_cast<EventType>(event_type);
+}
+
+size_t EventView::measure(const char *event, size_t available) {
+    if (available < EVENT_TYPE_SIZE) {
+        return EVENT_TYPE_SIZE;
+    }
+    event_type_t event_type;
+    load(event, event_type);
+    size_t length = EVENT_TYPE_SIZE;
+    switch (static_cast<EventType>(event_type)) {
+        case EventType::BombPlaced:
+            length += BombPlacedLayout::size;
+            break;
+        case EventType::BombExploded: {
+            // Bomb id and robots destroyed, then blocks destroyed.
+            length += BombExplodedLayout::size;
+            if (available < length) {
+                return length;
+            }
+            list_length_t robots_destroyed_size;
+            load(event + length - LIST_LENGTH_SIZE, robots_destroyed_size);
+            length += (size_t) robots_destroyed_size * PlayerIdLayout::size + LIST_LENGTH_SIZE;
+            if (available < length) {
+                return length;
+            }
+            list_length_t blocks_destroyed_size;
+            load(event + length - LIST_LENGTH_SIZE, blocks_destroyed_size);
+            length += (size_t) blocks_destroyed_size * PositionLayout::size;
+            break;
+        }
+        case EventType::PlayerMoved:
+            length += PlayerMovedLayout::size;
+            break;
+        case EventType::BlockPlaced:
+            length += BlockPlacedLayout::size;
+            break;
+        default:
+            throw std::invalid_argument("Incorrect event from server");
+    }
+    return length;
+}
+
+bomb_id_t EventView::get_bomb_id() const {
+    bomb_id_t bomb_id;
+    load(data, bomb_id);
+    return bomb_id;
+}
+
+player_id_t EventView::get_player_id() const {
+    return load_element<player_id_t>(data);
+}
+
+Position EventView::get_position() const {
+    switch (type) {
+        case EventType::BombPlaced:
+            return load_element<Position>(data + BOMB_ID_SIZE);
+        case EventType::PlayerMoved:
+            return load_element<Position>(data + PLAYER_ID_SIZE);
+        default:
+            return load_element<Position>(data);
+    }
+}
+
+RobotsView EventView::get_robots_destroyed() const {
+    list_length_t robots_destroyed_size;
+    load(data + BOMB_ID_SIZE, robots_destroyed_size);
+    return {data + BombExplodedLayout::size, robots_destroyed_size};
+}
+
+BlocksView EventView::get_blocks_destroyed() const {
+    RobotsView robots_destroyed = get_robots_destroyed();
+    const char *list = data + BombExplodedLayout::size +
+                       (size_t) robots_destroyed.size() * PlayerIdLayout::size;
+    list_length_t blocks_destroyed_size;
+    load(list, blocks_destroyed_size);
+    return {list + LIST_LENGTH_SIZE, blocks_destroyed_size};
+}
+
+TurnView::TurnView(const char *data, size_t length) : data(data), end_of_events(data + length) {
+    load(data, turn);
+    load(data + TURN_SIZE, events_size);
+}
+
+size_t TurnView::measure(const char *data, size_t available, MeasureProgress &progress) {
+    // Events are measured whole, so the progress is the length of the ones measured and the
+    // number of the ones left.
+    if (progress.length == 0) {
+        if (available < TurnLayout::size) {
+            progress.needed = TurnLayout::size;
+            return 0;
+        }
+        list_length_t events_size;
+        load(data + TURN_SIZE, events_size);
+        progress.length = TurnLayout::size;
+        progress.left = events_size;
+    }
+    for (; progress.left > 0; progress.left--) {
+        size_t rest = available - progress.length;
+        size_t event_length = EventView::measure(data + progress.length, rest);
+        if (event_length > rest) {
+            // Every next event takes at least as much as a BlockPlaced event.
+            progress.needed = progress.length + event_length +
+                              (size_t) (progress.left - 1) * BlockPlaced::ENCODED_SIZE;
+            return 0;
+        }
+        progress.length += event_length;
+    }
+    return progress.length;
+}
+
+void TurnView::apply(GameState &game_state) const {
+    // Clear explosions set.
+    game_state.explosions.clear();
+
+    game_state.turn = turn;
+
+    for (EventView event: *this) {
+        switch (event.get_type()) {
+            case EventType::BombPlaced:
+                BombPlaced(event.get_bomb_id(), event.get_position()).execute(game_state);
+                break;
+            case EventType::BombExploded:
+                BombExploded::calculate_explosion(event.get_bomb_id(), game_state);
+                // Remove the bomb.
+                game_state.bombs.erase(event.get_bomb_id());
+                break;
+            case EventType::PlayerMoved:
+                PlayerMoved(event.get_player_id(), event.get_position()).execute(game_state);
+                break;
+            case EventType::BlockPlaced:
+                BlockPlaced(event.get_position()).execute(game_state);
+                break;
+        }
+    }
+
+    // Robots and blocks destroyed in this turn are read again from the explosions (blocks are
+    // removed only after all of them are calculated).
+    std::bitset<PLAYERS_COUNT_MAX + 1> robots_destroyed;
+    for (EventView event: *this) {
+        if (event.get_type() == EventType::BombExploded) {
+            for (player_id_t robot_destroyed: event.get_robots_destroyed()) {
+                robots_destroyed.set(robot_destroyed);
+            }
+            // Remove blocks destroyed in this turn.
+            for (Position block_destroyed: event.get_blocks_destroyed()) {
+                game_state.blocks.erase(block_destroyed);
+            }
+        }
+    }
+
+    // Give a point to every player who died in this turn.
+    for (size_t player_id = 0; player_id < robots_destroyed.size(); player_id++) {
+        if (robots_destroyed.test(player_id)) {
+            game_state.scores[(player_id_t) player_id]++;
+        }
+    }
+}
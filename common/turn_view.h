@@ -0,0 +1,143 @@
+#ifndef TURN_VIEW_H
+#define TURN_VIEW_H
+
+#include "events.h"
+
+// Functions decoding a single element of a list kept in received bytes.
+template <typename T>
+T load_element(const char *data);
+
+template <>
+inline player_id_t load_element<player_id_t>(const char *data) {
+    player_id_t player_id;
+    load(data, player_id);
+    return player_id;
+}
+
+template <>
+inline Position load_element<Position>(const char *data) {
+    coordinate_t x, y;
+    load(data, x);
+    load(data + COORDINATE_SIZE, y);
+    return {x, y};
+}
+
+// List of fixed-size elements kept in received bytes, decoded one by one while iterated.
+template <typename T, size_t ELEMENT_SIZE>
+class ListView {
+private:
+    const char *data;
+    list_length_t length;
+
+public:
+    class Iterator {
+    private:
+        const char *data;
+
+    public:
+        explicit Iterator(const char *data) : data(data) {}
+        T operator*() const {
+            return load_element<T>(data);
+        }
+        Iterator &operator++() {
+            data += ELEMENT_SIZE;
+            return *this;
+        }
+        bool operator!=(const Iterator &that) const {
+            return data != that.data;
+        }
+    };
+
+    ListView(const char *data, list_length_t length) : data(data), length(length) {}
+
+    [[nodiscard]] list_length_t size() const {
+        return length;
+    }
+    [[nodiscard]] Iterator begin() const {
+        return Iterator(data);
+    }
+    [[nodiscard]] Iterator end() const {
+        return Iterator(data + (size_t) length * ELEMENT_SIZE);
+    }
+};
+
+using RobotsView = ListView<player_id_t, PlayerIdLayout::size>;
+using BlocksView = ListView<Position, PositionLayout::size>;
+
+// Event kept in received bytes. Its fields are decoded when accessed.
+class EventView {
+private:
+    EventType type;
+    const char *data; // Event without the event type.
+
+public:
+    explicit EventView(const char *event);
+
+    // Returns the length of an event (with its type) starting at 'event' if all of it is among
+    // 'available' bytes, otherwise a lower bound of it greater than 'available'. Throws if
+    // event type is incorrect.
+    static size_t measure(const char *event, size_t available);
+
+    [[nodiscard]] EventType get_type() const {
+        return type;
+    }
+    [[nodiscard]] bomb_id_t get_bomb_id() const; // For BombPlaced and BombExploded.
+    [[nodiscard]] player_id_t get_player_id() const; // For PlayerMoved.
+    [[nodiscard]] Position get_position() const; // For BombPlaced, PlayerMoved, BlockPlaced.
+    [[nodiscard]] RobotsView get_robots_destroyed() const; // For BombExploded.
+    [[nodiscard]] BlocksView get_blocks_destroyed() const; // For BombExploded.
+};
+
+// Turn message (without the message id) decoded in place: events and lists of destroyed
+// robots and blocks are read directly from received bytes, without intermediate objects.
+class TurnView {
+private:
+    const char *data;
+    const char *end_of_events; // Equal to the end of the message.
+    turn_t turn{};
+    list_length_t events_size{};
+
+public:
+    class Iterator {
+    private:
+        const char *event;
+
+    public:
+        explicit Iterator(const char *event) : event(event) {}
+        EventView operator*() const {
+            return EventView(event);
+        }
+        Iterator &operator++() {
+            event += EventView::measure(event, SIZE_MAX);
+            return *this;
+        }
+        bool operator!=(const Iterator &that) const {
+            return event != that.event;
+        }
+    };
+
+    // 'data' has to contain the whole message (see 'measure').
+    TurnView(const char *data, size_t length);
+
+    // Returns the length of a Turn message (without the message id) starting at 'data' if all
+    // of it is among 'available' bytes, 0 otherwise (resuming from 'progress', see Buffer).
+    static size_t measure(const char *data, size_t available, MeasureProgress &progress);
+
+    // Updates 'game_state' with the events of the turn.
+    void apply(GameState &game_state) const;
+
+    [[nodiscard]] turn_t get_turn() const {
+        return turn;
+    }
+    [[nodiscard]] list_length_t size() const {
+        return events_size;
+    }
+    [[nodiscard]] Iterator begin() const {
+        return Iterator(data + TurnLayout::size);
+    }
+    [[nodiscard]] Iterator end() const {
+        return Iterator(end_of_events);
+    }
+};
+
+#endif //TURN_VIEW_H
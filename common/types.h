@@ -12,6 +12,17 @@ using initial_blocks_parsing_t = int32_t;
 using game_length_parsing_t = int32_t;
 using seed_parsing_t = int64_t;
 using coordinate_parsing_t = int32_t;
+using send_batch_bytes_parsing_t = int64_t;
+using explosion_threads_parsing_t = int32_t;
+using action_threads_parsing_t = int32_t;
+using simulation_threads_parsing_t = int32_t;
+using network_threads_parsing_t = int32_t;
+using max_connections_parsing_t = int64_t;
+using spin_wait_parsing_t = int32_t;
+using rooms_parsing_t = int32_t;
+using room_threads_parsing_t = int32_t;
+using max_queued_messages_parsing_t = int64_t;
+using max_queued_bytes_parsing_t = int64_t;
 
 constexpr players_count_parsing_t PLAYERS_COUNT_MAX = UINT8_MAX;
 
@@ -37,6 +48,7 @@ using bomb_id_t = uint32_t;
 using player_id_t = uint8_t;
 using score_t = uint32_t;
 using turn_t = uint16_t;
+using explosion_turn_t = uint32_t; // Turn of placing a bomb plus the bomb timer.
 using coordinate_t = uint16_t;
 using turn_duration_t = uint64_t;
 using initial_blocks_t = uint16_t;
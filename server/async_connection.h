@@ -0,0 +1,270 @@
+#ifndef ASYNC_CONNECTION_H
+#define ASYNC_CONNECTION_H
+
+#include <utility>
+#include "../common/socket_buffer.h"
+#include "connection.h"
+
+// Memory for handlers of a posted write (the write and the strand running it), so that posting
+// it (once a turn, by the thread running the game) doesn't allocate memory. Larger handlers, or
+// handlers allocated while all blocks are taken, use the heap.
+class HandlerMemory {
+private:
+    static constexpr size_t BLOCKS = 2;
+    static constexpr size_t BLOCK_SIZE = 256;
+
+    alignas(std::max_align_t) char storage[BLOCKS][BLOCK_SIZE];
+    std::array<std::atomic<bool>, BLOCKS> in_use{};
+
+public:
+    void *allocate(size_t size) {
+        if (size <= BLOCK_SIZE) {
+            for (size_t block = 0; block < BLOCKS; block++) {
+                if (!in_use[block].exchange(true)) {
+                    return storage[block];
+                }
+            }
+        }
+        return ::operator new(size);
+    }
+
+    void deallocate(void *pointer) {
+        for (size_t block = 0; block < BLOCKS; block++) {
+            if (pointer == storage[block]) {
+                in_use[block] = false;
+                return;
+            }
+        }
+        ::operator delete(pointer);
+    }
+};
+
+template <typename T>
+class HandlerAllocator {
+private:
+    template <typename> friend class HandlerAllocator;
+    HandlerMemory *memory;
+
+public:
+    using value_type = T;
+
+    explicit HandlerAllocator(HandlerMemory &memory) : memory(&memory) {}
+
+    template <typename U>
+    HandlerAllocator(const HandlerAllocator<U> &other) noexcept : memory(other.memory) {}
+
+    T *allocate(size_t count) {
+        return static_cast<T *>(memory->allocate(sizeof(T) * count));
+    }
+
+    void deallocate(T *pointer, size_t) {
+        memory->deallocate(pointer);
+    }
+
+    template <typename U>
+    bool operator==(const HandlerAllocator<U> &other) const noexcept {
+        return memory == other.memory;
+    }
+};
+
+// Connection served by threads running the io_context, with asynchronous reads and writes. All
+// operations on the socket run on the strand of the connection, so a connection is served by
+// at most one thread at a time, and a pending read or write doesn't take a thread.
+class AsyncConnection : public Connection, public std::enable_shared_from_this<AsyncConnection> {
+private:
+    // Length of the longest message from client (a Join message with a name of 255 bytes).
+    static constexpr size_t MAX_MESSAGE_LENGTH = MESSAGE_ID_SIZE + STRING_LENGTH_SIZE + UINT8_MAX;
+
+    as::ip::tcp::socket socket;
+    as::strand<as::io_context::executor_type> strand;
+    // Received bytes, of which those from 'received_start' to 'received_end' aren't handled yet.
+    std::vector<char> received;
+    size_t received_start = 0;
+    size_t received_end = 0;
+    BufferMemory message_buffer{MAX_MESSAGE_LENGTH}; // A received message being decoded.
+    // Messages being sent and their bytes (used only on the strand).
+    std::vector<const EncodedMessage *> sent_messages;
+    std::vector<as::const_buffer> buffers;
+    // Set while a write is posted or in progress, so that messages appended meanwhile don't
+    // post another one.
+    std::atomic<bool> write_scheduled = false;
+    HandlerMemory write_handler_memory;
+    std::atomic<size_t> buffers_memory = 0; // Taken by the vectors above.
+    // Statistics.
+    uint64_t read_syscalls = 0;
+    uint64_t messages_received = 0;
+    uint64_t write_syscalls = 0;
+    uint64_t messages_sent = 0;
+
+    void update_buffers_memory() {
+        buffers_memory = received.capacity() + MAX_MESSAGE_LENGTH +
+                         sent_messages.capacity() * sizeof(const EncodedMessage *) +
+                         buffers.capacity() * sizeof(as::const_buffer);
+    }
+
+    void read() {
+        if (received_start == received_end) {
+            received_start = 0;
+            received_end = 0;
+        } else if (received_end == received.size()) {
+            // Move the beginning of a message to the beginning of the buffer, growing it (at
+            // least twice) if the message doesn't fit in it.
+            size_t unread = received_end - received_start;
+            memmove(received.data(), received.data() + received_start, unread);
+            received_start = 0;
+            received_end = unread;
+            if (unread == received.size()) {
+                received.resize(2 * received.size());
+                update_buffers_memory();
+            }
+        }
+        socket.async_read_some(
+                as::buffer(received.data() + received_end, received.size() - received_end),
+                as::bind_executor(strand, [self = shared_from_this()](
+                        const boost::system::error_code &error, size_t length) {
+                    self->on_read(error, length);
+                }));
+    }
+
+    void on_read(const boost::system::error_code &error, size_t length) {
+        if (closed) {
+            return;
+        }
+        if (error) {
+            close();
+            return;
+        }
+        read_syscalls++;
+        received_end += length;
+        try {
+            size_t message_length;
+            while ((message_length = ClientMessage::measure(received.data() + received_start,
+                                                            received_end - received_start))) {
+                message_buffer.load(received.data() + received_start, message_length);
+                received_start += message_length;
+                messages_received++;
+                receive_message(ClientMessage(message_buffer));
+            }
+        } catch (std::exception &e) {
+            close();
+            return;
+        }
+        read();
+    }
+
+    // Writes all queued messages (up to the byte budget) with a single write, and repeats until
+    // there are no more messages.
+    void write() {
+        sent_messages.clear();
+        buffers.clear();
+        bool taken;
+        try {
+            taken = !closed && client_queue.read(sent_messages, options.send_batch_bytes);
+        } catch (std::exception &e) {
+            close();
+            return;
+        }
+        if (!taken) {
+            write_scheduled = false;
+            // A message appended before clearing the flag didn't schedule a write.
+            if (!closed && client_queue.has_messages() && !write_scheduled.exchange(true)) {
+                write();
+            }
+            return;
+        }
+        bool compact = compact_encoding;
+        for (auto const & server_message: sent_messages) {
+            buffers.emplace_back(server_message->get_data(compact),
+                                 server_message->get_length(compact));
+        }
+        update_buffers_memory();
+        as::async_write(socket, buffers, as::bind_executor(strand, [self = shared_from_this()](
+                const boost::system::error_code &error, size_t) {
+            if (error) {
+                self->close();
+                return;
+            }
+            self->write_syscalls++;
+            self->messages_sent += self->sent_messages.size();
+            self->write();
+        }));
+    }
+
+    void print_statistics() const {
+        if (options.statistics) {
+            std::cerr << "Client " << client_address << ": " << messages_received
+                      << " messages received with " << read_syscalls << " read syscalls ("
+                      << (messages_received > 0 ? (double) read_syscalls /
+                                                  (double) messages_received : 0)
+                      << " per message)\n";
+            std::cerr << "Client " << client_address << ": " << messages_sent
+                      << " messages sent with " << write_syscalls << " write syscalls ("
+                      << (write_syscalls > 0 ? (double) messages_sent / (double) write_syscalls : 0)
+                      << " messages per syscall)\n";
+        }
+    }
+
+    void close() {
+        if (!set_closed()) {
+            return;
+        }
+        print_statistics();
+        boost::system::error_code error;
+        socket.shutdown(as::ip::tcp::socket::shutdown_both, error);
+        socket.close(error);
+    }
+
+    // Handler of a posted write, allocated in 'write_handler_memory'.
+    struct ScheduledWrite {
+        std::shared_ptr<AsyncConnection> connection;
+
+        using allocator_type = HandlerAllocator<ScheduledWrite>;
+
+        [[nodiscard]] allocator_type get_allocator() const noexcept {
+            return allocator_type(connection->write_handler_memory);
+        }
+
+        void operator()() const {
+            connection->write();
+        }
+    };
+
+public:
+    explicit AsyncConnection(as::io_context &io_context, as::ip::tcp::socket socket,
+                             std::string client_address, client_id_t client_id,
+                             GameManager &game_manager, const ServerOptions &options,
+                             ClientQueueMetrics &queue_metrics) :
+            Connection(std::move(client_address), client_id, game_manager, options,
+                       queue_metrics),
+            socket(std::move(socket)), strand(as::make_strand(io_context)),
+            received(TCP_BUFFER_SIZE) {
+        update_buffers_memory();
+    }
+
+    // Starts reading messages and sending the messages sent before the connection.
+    void start() {
+        write_scheduled = true;
+        as::post(strand, [self = shared_from_this()] {
+            self->read();
+            self->write();
+        });
+    }
+
+    void schedule_sending() override {
+        if (!is_closed() && !write_scheduled.exchange(true)) {
+            as::post(strand, ScheduledWrite{shared_from_this()});
+        }
+    }
+
+    void disconnect() override {
+        as::post(strand, [self = shared_from_this()] {
+            self->close();
+        });
+    }
+
+    [[nodiscard]] size_t get_memory_usage() override {
+        return sizeof(AsyncConnection) + buffers_memory;
+    }
+};
+
+#endif //ASYNC_CONNECTION_H
@@ -3,23 +3,80 @@
 
 #include <mutex>
 #include <condition_variable>
-#include <queue>
+#include <vector>
 #include "../common/messages.h"
 
-// Blocking queue for shared pointers of server messages, used by client connections and server.
+// Queue of shared pointers of encoded server messages, kept in a ring buffer. Unlike std::queue
+// it keeps its memory when messages are popped, so in a steady state pushing a message doesn't
+// allocate memory.
+class MessageQueue {
+private:
+    std::vector<std::shared_ptr<const EncodedMessage>> messages;
+    size_t first = 0;
+    size_t count = 0;
+
+public:
+    [[nodiscard]] bool empty() const {
+        return count == 0;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return count;
+    }
+
+    std::shared_ptr<const EncodedMessage> &front() {
+        return messages[first];
+    }
+
+    // Makes room for 'capacity' messages.
+    void reserve(size_t capacity) {
+        if (capacity <= messages.size()) {
+            return;
+        }
+        std::vector<std::shared_ptr<const EncodedMessage>> new_messages(capacity);
+        for (size_t i = 0; i < count; i++) {
+            new_messages[i] = std::move(messages[(first + i) % messages.size()]);
+        }
+        messages = std::move(new_messages);
+        first = 0;
+    }
+
+    void push(const std::shared_ptr<const EncodedMessage> &message) {
+        if (count == messages.size()) {
+            reserve(std::max((size_t) 16, 2 * messages.size()));
+        }
+        messages[(first + count) % messages.size()] = message;
+        count++;
+    }
+
+    void pop() {
+        messages[first].reset();
+        first = (first + 1) % messages.size();
+        count--;
+    }
+
+    // Removes all messages (keeping the memory).
+    void clear() {
+        while (!empty()) {
+            pop();
+        }
+    }
+};
+
+// Blocking queue for shared pointers of encoded server messages, used by client connections and server.
 class BlockingMessageQueue {
 private:
     std::mutex mutex;
     std::condition_variable condition_variable;
-    std::queue<std::shared_ptr<ServerMessage>> queue;
+    MessageQueue queue;
     bool client_connection_closed = false;
 
 public:
     BlockingMessageQueue() = default;
-    explicit BlockingMessageQueue(std::queue<std::shared_ptr<ServerMessage>> queue) :
+    explicit BlockingMessageQueue(MessageQueue queue) :
             queue(std::move(queue)) {}
 
-    void push(const std::shared_ptr<ServerMessage> &message) {
+    void push(const std::shared_ptr<const EncodedMessage> &message) {
         {
             std::lock_guard<std::mutex> lock(mutex);
             queue.push(message);
@@ -27,17 +84,28 @@ public:
         condition_variable.notify_one();
     }
 
-    std::shared_ptr<ServerMessage> pop() {
+    std::shared_ptr<const EncodedMessage> pop() {
         std::unique_lock<std::mutex> lock(mutex);
         condition_variable.wait(lock, [&]{ return !queue.empty() || client_connection_closed; });
         if (client_connection_closed) {
             throw std::invalid_argument("Connection closed cleanly by peer");
         }
-        std::shared_ptr<ServerMessage> message(std::move(queue.front()));
+        std::shared_ptr<const EncodedMessage> message(std::move(queue.front()));
         queue.pop();
         return message;
     }
 
+    // Like 'pop', but doesn't wait for a message: returns false if there are none.
+    bool try_pop(std::shared_ptr<const EncodedMessage> &message) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queue.empty()) {
+            return false;
+        }
+        message = std::move(queue.front());
+        queue.pop();
+        return true;
+    }
+
     void close_client_connection() {
         {
             std::lock_guard lock(mutex);
@@ -1,33 +1,45 @@
 #ifndef CLIENT_H
 #define CLIENT_H
 
+#include <pthread.h>
 #include <utility>
+#include "connection.h"
 #include "message_sender.h"
 #include "message_receiver.h"
 
-class ClientConnection {
+// Connection served by its own two threads, one receiving and one sending messages with
+// blocking reads and writes.
+class ClientConnection : public Connection {
 private:
     std::shared_ptr<as::ip::tcp::socket> client_socket;
-    std::string client_address;
     std::thread thread_client;
     MessageSender message_sender;
     MessageReceiver message_receiver;
-    ClientMessage newest_message;
-    bool new_message = false;
-    std::mutex new_message_mutex;
-    bool closed = false;
-    std::mutex closed_mutex;
+
+    // Returns the size of the stack of a new thread (reserved, but mostly not used).
+    static size_t get_thread_stack_size() {
+        pthread_attr_t attributes;
+        size_t stack_size = 0;
+        if (pthread_attr_init(&attributes) == 0) {
+            pthread_attr_getstacksize(&attributes, &stack_size);
+            pthread_attr_destroy(&attributes);
+        }
+        return stack_size;
+    }
 
 public:
     explicit ClientConnection(const std::shared_ptr<as::ip::tcp::socket> &client_socket,
                               std::string client_address, client_id_t client_id,
-                              GameState &game_state, GameManager &game_manager) :
-            client_socket(client_socket), client_address(std::move(client_address)),
-            message_sender(client_socket, game_state, game_manager),
-            message_receiver(client_socket, this->client_address, client_id, game_manager,
-                             newest_message, new_message, new_message_mutex) {}
+                              GameManager &game_manager, const ServerOptions &options,
+                              ClientQueueMetrics &queue_metrics) :
+            Connection(std::move(client_address), client_id, game_manager, options,
+                       queue_metrics),
+            client_socket(client_socket),
+            message_sender(client_socket, this->client_address, client_queue, options,
+                           compact_encoding),
+            message_receiver(client_socket, this->client_address, options, *this) {}
 
-    ~ClientConnection() {
+    ~ClientConnection() override {
         if (thread_client.joinable()) {
             thread_client.join();
         }
@@ -50,11 +62,8 @@ public:
                 // Ignore.
             }
             client_socket->close();
-            {
-                // Mark connection as closed.
-                std::lock_guard<std::mutex> lock(closed_mutex);
-                closed = true;
-            }
+            // Mark connection as closed.
+            set_closed();
         }
     }
 
@@ -62,30 +71,19 @@ public:
         thread_client = std::move(thread);
     }
 
-    // Returns true if client sent a new message since the last reset.
-    bool has_a_new_message() {
-        std::lock_guard<std::mutex> lock(new_message_mutex);
-        return new_message;
-    }
-
-    ClientMessage get_newest_message() {
-        return newest_message;
-    }
+    // The sender waits for messages on the log itself.
+    void schedule_sending() override {}
 
-    void reset_newest_message() {
-        std::lock_guard<std::mutex> lock(new_message_mutex);
-        new_message = false;
+    // Shuts the socket down, which wakes up both threads of the connection (also from a blocked
+    // write), and they close it.
+    void disconnect() override {
+        ::shutdown(client_socket->native_handle(), SHUT_RDWR);
     }
 
-    [[nodiscard]] bool is_closed() {
-        std::lock_guard<std::mutex> lock(closed_mutex);
-        return closed;
-    }
-
-    void send_message(const std::shared_ptr<ServerMessage> &server_message) {
-        if (!is_closed()) {
-            message_sender.send_message(server_message);
-        }
+    [[nodiscard]] size_t get_memory_usage() override {
+        static const size_t thread_stack_size = get_thread_stack_size();
+        // Threads receiving and sending messages, and the buffer of received messages.
+        return sizeof(ClientConnection) + 2 * thread_stack_size + TCP_BUFFER_SIZE;
     }
 };
 
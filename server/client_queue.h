@@ -0,0 +1,223 @@
+#ifndef CLIENT_QUEUE_H
+#define CLIENT_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include "message_log.h"
+#include "server_options.h"
+
+// Statistics of queues of clients of a room: their depths, sampled by the room after sending
+// messages of a step, and how often the slow client policy applied to them.
+class ClientQueueMetrics {
+private:
+    // Written only by the thread running the room.
+    uint64_t samples = 0;
+    uint64_t total_messages = 0;
+    uint64_t max_messages = 0;
+    uint64_t max_bytes = 0;
+
+public:
+    // Counted by threads sending messages to clients.
+    std::atomic<uint64_t> disconnected = 0;
+    std::atomic<uint64_t> coalesces = 0;
+    std::atomic<uint64_t> coalesced_turns = 0;
+    std::atomic<uint64_t> over_hard_limit = 0; // Clients coalescing, disconnected anyway.
+
+    void add_sample(uint64_t messages, uint64_t bytes) {
+        samples++;
+        total_messages += messages;
+        max_messages = std::max(max_messages, messages);
+        max_bytes = std::max(max_bytes, bytes);
+    }
+
+    void reset() {
+        samples = 0;
+        total_messages = 0;
+        max_messages = 0;
+        max_bytes = 0;
+        disconnected = 0;
+        coalesces = 0;
+        coalesced_turns = 0;
+        over_hard_limit = 0;
+    }
+
+    // Prints statistics, starting every line with 'prefix'.
+    void print(std::ostream &out, const std::string &prefix) const {
+        out << prefix << "Client queues: mean depth "
+            << (samples > 0 ? (double) total_messages / (double) samples : 0)
+            << " messages, max " << max_messages << " messages, max " << max_bytes << " bytes\n";
+        out << prefix << "Slow clients: " << disconnected << " disconnected, " << coalesces
+            << " coalesces (" << coalesced_turns << " Turn messages joined), "
+            << over_hard_limit << " disconnected over the hard limit\n";
+    }
+};
+
+// Messages waiting to be sent to a client: those of the log of its game following its cursor.
+// Its depth (in messages and in bytes of their standard encoding) is the distance from the
+// cursor to the end of the log. Once it exceeds a limit of ServerOptions, the slow client
+// policy applies when the client takes its messages: the client is disconnected, or runs of
+// queued Turn messages are joined into catch-up Turn messages (only where that leaves the client
+// in the same state, so it misses no events). A client whose messages are coalesced is still
+// disconnected over a hard limit, a multiple of the limit.
+class ClientQueue {
+private:
+    // Coalescing can't join turns with explosions, and a client that stopped reading leaves its
+    // sending blocked (so it never coalesces), so its queue could grow without bounds.
+    static constexpr uint64_t HARD_LIMIT_FACTOR = 4;
+
+    MessageLog &message_log;
+    MessageLog::Cursor cursor; // Used only by the thread sending messages to the client.
+    const ServerOptions &options;
+    ClientQueueMetrics &metrics;
+    // Position of the cursor, published for the thread running the room.
+    std::atomic<uint64_t> read_messages;
+    std::atomic<uint64_t> read_bytes;
+    std::atomic<bool> disconnected = false;
+    // Joined Turn messages, sent until the next 'read'.
+    std::vector<std::shared_ptr<const EncodedMessage>> catch_up_turns;
+
+    [[nodiscard]] bool is_over_limit(uint64_t messages, uint64_t bytes, uint64_t factor) const {
+        return (options.max_queued_messages > 0 &&
+                messages > factor * options.max_queued_messages) ||
+               (options.max_queued_bytes > 0 && bytes > factor * options.max_queued_bytes);
+    }
+
+    // Marks the client as disconnected and counts it (once).
+    bool set_disconnected() {
+        if (disconnected.exchange(true)) {
+            return false;
+        }
+        if (options.slow_client_policy == SlowClientPolicy::Coalesce) {
+            metrics.over_hard_limit++;
+        } else {
+            metrics.disconnected++;
+        }
+        return true;
+    }
+
+    // Returns true if messages taken by a client (from 'first'), after their Turn messages are
+    // coalesced, are still over the hard limit.
+    [[nodiscard]] bool is_over_hard_limit(const std::vector<const EncodedMessage *> &messages,
+                                          size_t first) const {
+        uint64_t bytes = 0;
+        for (size_t i = first; i < messages.size(); i++) {
+            bytes += messages[i]->get_length();
+        }
+        return is_over_limit(messages.size() - first, bytes, HARD_LIMIT_FACTOR);
+    }
+
+    void publish_position() {
+        read_messages.store(cursor.get_message_position(), std::memory_order_release);
+        read_bytes.store(cursor.get_byte_position(), std::memory_order_release);
+    }
+
+    // Replaces runs of consecutive Turn messages among 'messages' (from 'first') with joined
+    // ones. A run continues past a Turn message only if it can precede another turn.
+    void coalesce_turns(std::vector<const EncodedMessage *> &messages, size_t first) {
+        size_t kept = first;
+        for (size_t run = first; run < messages.size();) {
+            size_t run_end = run + 1;
+            while (run_end < messages.size() &&
+                   messages[run_end]->get_type() == ServerMessageType::Turn &&
+                   messages[run_end - 1]->can_precede_turn()) {
+                run_end++;
+            }
+            if (run_end - run > 1) {
+                catch_up_turns.push_back(EncodedMessage::coalesce_turns(
+                        std::span<const EncodedMessage *const>(messages.data() + run,
+                                                               run_end - run)));
+                messages[kept++] = catch_up_turns.back().get();
+                metrics.coalesces++;
+                metrics.coalesced_turns += run_end - run;
+            } else {
+                messages[kept++] = messages[run];
+            }
+            run = run_end;
+        }
+        messages.resize(kept);
+    }
+
+public:
+    explicit ClientQueue(MessageLog &message_log, const ServerOptions &options,
+                         ClientQueueMetrics &metrics) :
+            message_log(message_log), cursor(message_log.begin()), options(options),
+            metrics(metrics), read_messages(cursor.get_message_position()),
+            read_bytes(cursor.get_byte_position()) {}
+    ClientQueue(const ClientQueue &) = delete;
+    ClientQueue &operator=(const ClientQueue &) = delete;
+
+    [[nodiscard]] MessageLog &get_message_log() {
+        return message_log;
+    }
+
+    // Returns the number of queued messages and their bytes. The cursor can be ahead of the
+    // counters of the log for a moment (they are published after messages).
+    void get_depth(uint64_t &messages, uint64_t &bytes) const {
+        uint64_t appended_messages = message_log.get_appended_messages();
+        uint64_t appended_bytes = message_log.get_appended_bytes();
+        uint64_t position = read_messages.load(std::memory_order_acquire);
+        uint64_t byte_position = read_bytes.load(std::memory_order_acquire);
+        messages = appended_messages > position ? appended_messages - position : 0;
+        bytes = appended_bytes > byte_position ? appended_bytes - byte_position : 0;
+    }
+
+    [[nodiscard]] bool is_over_limit() const {
+        uint64_t messages;
+        uint64_t bytes;
+        get_depth(messages, bytes);
+        return is_over_limit(messages, bytes, 1);
+    }
+
+    // Returns true (once) if the client has to be disconnected for being over the limit (or
+    // over the hard limit, if its Turn messages are coalesced).
+    bool should_disconnect() {
+        uint64_t messages;
+        uint64_t bytes;
+        get_depth(messages, bytes);
+        bool coalesce = options.slow_client_policy == SlowClientPolicy::Coalesce;
+        return is_over_limit(messages, bytes, coalesce ? HARD_LIMIT_FACTOR : 1) &&
+               set_disconnected();
+    }
+
+    // Takes queued messages like MessageLog::read, applying the slow client policy if the
+    // client is over the limit. Throws if the client has to be disconnected. A client whose Turn
+    // messages are coalesced takes all messages at hand, so that runs are as long as possible,
+    // and is disconnected if they are still over the hard limit after coalescing.
+    bool read(std::vector<const EncodedMessage *> &messages, size_t max_bytes) {
+        catch_up_turns.clear();
+        if (disconnected) {
+            throw std::length_error("Client fell too far behind");
+        }
+        bool coalesce = false;
+        if (is_over_limit()) {
+            if (should_disconnect()) {
+                throw std::length_error("Client fell too far behind");
+            }
+            coalesce = options.slow_client_policy == SlowClientPolicy::Coalesce;
+        }
+        size_t first = messages.size();
+        if (!message_log.read(cursor, messages, coalesce ? SIZE_MAX : max_bytes)) {
+            publish_position(); // The cursor could move on to a new segment.
+            return false;
+        }
+        if (coalesce) {
+            coalesce_turns(messages, first);
+            if (is_over_hard_limit(messages, first)) {
+                publish_position();
+                set_disconnected();
+                throw std::length_error("Client fell too far behind");
+            }
+        }
+        publish_position();
+        return true;
+    }
+
+    [[nodiscard]] bool has_messages() const {
+        return message_log.has_messages(cursor);
+    }
+};
+
+#endif //CLIENT_QUEUE_H
@@ -0,0 +1,107 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <atomic>
+#include <utility>
+#include "client_queue.h"
+#include "game_manager.h"
+#include "server_options.h"
+
+// Connection with a client, served either by its own threads (ClientConnection) or by threads
+// serving all connections (AsyncConnection). It keeps the newest game message of the client in
+// a single atomic slot, which the server empties once a turn, and the queue of messages waiting
+// to be sent to the client.
+class Connection {
+protected:
+    std::string client_address;
+    client_id_t client_id;
+    GameManager &game_manager;
+    const ServerOptions &options;
+    std::atomic<bool> compact_encoding = false; // Client opted in to the compact encoding.
+    std::atomic<PlayerInput> newest_input;
+    static_assert(std::atomic<PlayerInput>::is_always_lock_free);
+    std::atomic<bool> closed = false;
+    ClientQueue client_queue;
+
+    // Marks the connection as closed and gives back the player slot claimed by client (if it
+    // didn't join). Returns false if the connection was closed already.
+    bool set_closed() {
+        if (closed.exchange(true)) {
+            return false;
+        }
+        game_manager.release_player_slot(client_id);
+        return true;
+    }
+
+public:
+    explicit Connection(std::string client_address, client_id_t client_id,
+                        GameManager &game_manager, const ServerOptions &options,
+                        ClientQueueMetrics &queue_metrics) :
+            client_address(std::move(client_address)), client_id(client_id),
+            game_manager(game_manager), options(options),
+            client_queue(game_manager.get_message_log(), options, queue_metrics) {}
+    Connection(const Connection &) = delete;
+    Connection &operator=(const Connection &) = delete;
+    virtual ~Connection() = default;
+
+    // Handles a message received from client. Throws if client needs to be disconnected.
+    void receive_message(const ClientMessage &client_message) {
+        if (!client_message.is_correct()) {
+            // Client needs to be disconnected.
+            throw std::invalid_argument("Incorrect message from client");
+        }
+        switch (client_message.get_type()) {
+            case ClientMessageType::Join: {
+                Player player(client_message.get_player_name(), client_address);
+                game_manager.add_player(player, client_id);
+                break;
+            }
+            case ClientMessageType::PlaceBomb:
+            case ClientMessageType::PlaceBlock:
+            case ClientMessageType::Move:
+                // Replaces a message not taken yet.
+                newest_input.store(PlayerInput(client_message), std::memory_order_release);
+                break;
+            case ClientMessageType::UseCompactEncoding:
+                // Messages sent from now on will use the compact encoding.
+                compact_encoding = true;
+                break;
+        }
+    }
+
+    // Returns the newest game message of client (empty if client sent none since the last
+    // call) and empties the slot.
+    PlayerInput take_newest_input() {
+        return newest_input.exchange(PlayerInput(), std::memory_order_acquire);
+    }
+
+    [[nodiscard]] bool is_closed() const {
+        return closed;
+    }
+
+    [[nodiscard]] const ClientQueue &get_client_queue() const {
+        return client_queue;
+    }
+
+    // Called after messages are appended to the log of the game, which client reads with its
+    // own cursor. A client over the limit of queued messages is disconnected here if the policy
+    // says so, as its sending may be blocked (and never take messages again).
+    void notify_new_messages() {
+        if (client_queue.should_disconnect()) {
+            disconnect();
+        } else {
+            schedule_sending();
+        }
+    }
+
+    // Makes the thread sending messages to client take the new messages.
+    virtual void schedule_sending() = 0;
+
+    // Closes the connection from a thread not serving it.
+    virtual void disconnect() = 0;
+
+    // Returns memory reserved for the connection (its buffers and threads) in bytes.
+    [[nodiscard]] virtual size_t get_memory_usage() = 0;
+};
+
+#endif //CONNECTION_H
@@ -1,62 +1,76 @@
 #ifndef GAME_MANAGER_H
 #define GAME_MANAGER_H
 
+#include <functional>
+#include <set>
 #include <utility>
-#include <random>
+#include "../common/game_engine.h"
 #include "blocking_queue.h"
-
-constexpr turn_t TURN_ZERO = 0;
+#include "message_log.h"
 
 class GameManager {
 private:
     GameState &game_state;
     IdGenerator<player_id_t> player_id_generator;
     std::map<client_id_t, player_id_t> &client_to_player_id;
-    // If server is in Lobby state 'past_messages' contains a Hello message and all sent
+    // If server is in Lobby state 'message_log' contains a Hello message and all sent
     // AcceptedPlayer messages. If it is in Game state, it contains a Hello message and all sent
     // Turn messages.
-    std::queue<std::shared_ptr<ServerMessage>> past_messages;
-    std::mutex past_messages_mutex;
+    MessageLog message_log;
     BlockingMessageQueue &pending_messages;
-    std::minstd_rand random;
-    IdGenerator<bomb_id_t> bomb_id_generator;
+    GameEngine game_engine;
+    // Clients matched with the lobby, each claiming a player slot until it joins, its connection
+    // closes or the game starts (and it observes the game). Guarded by 'game_state.mutex'.
+    std::set<client_id_t> claimed_slots;
+    std::function<void()> player_joined; // Called after an AcceptedPlayer message is sent.
+
+    void reset_past_messages(size_t capacity);
 
-    void reset_past_messages();
-    Position get_random_position();
+    // Returns the number of messages of the lobby: Hello and AcceptedPlayer messages.
+    [[nodiscard]] size_t get_lobby_messages_count() const {
+        return (size_t) game_state.players_count + 1;
+    }
 
-    void process_bombs(std::vector<std::shared_ptr<Event>> &events,
-                       std::set<player_id_t> &current_turn_robots_destroyed);
-    void process_place_bomb(std::vector<std::shared_ptr<Event>> &events, player_id_t player_id);
-    void process_place_block(std::vector<std::shared_ptr<Event>> &events, player_id_t player_id);
-    void process_move(std::vector<std::shared_ptr<Event>> &events, player_id_t player_id,
-                      direction_t direction);
-    void process_player_moves(std::vector<std::shared_ptr<Event>> &events,
-                              std::map<player_id_t, ClientMessage> current_turn_messages,
-                              const std::set<player_id_t>& current_turn_robots_destroyed);
+    void send_message(const ServerMessage &server_message);
 
 public:
     explicit GameManager(GameState &game_state,
                          std::map<client_id_t, player_id_t> &client_to_player_id,
-                         BlockingMessageQueue &pending_messages) :
+                         BlockingMessageQueue &pending_messages, size_t explosion_threads = 1,
+                         size_t action_threads = 1, std::function<void()> player_joined = {}) :
             game_state(game_state), client_to_player_id(client_to_player_id),
-            pending_messages(pending_messages), random(game_state.seed) {
-        reset_past_messages();
+            pending_messages(pending_messages),
+            game_engine(game_state, explosion_threads, action_threads),
+            player_joined(std::move(player_joined)) {
+        reset_past_messages(get_lobby_messages_count());
     }
 
-    std::shared_ptr<BlockingMessageQueue> get_past_messages() {
-        std::lock_guard<std::mutex> lock(past_messages_mutex);
-        return std::make_shared<BlockingMessageQueue>(past_messages);
+    // Returns the log of messages sent to clients. A client connecting reads it from the
+    // beginning.
+    MessageLog &get_message_log() {
+        return message_log;
     }
 
-    void add_past_message(const std::shared_ptr<ServerMessage> &message) {
-        std::lock_guard<std::mutex> lock(past_messages_mutex);
-        past_messages.push(message);
+    // Appends a message sent to clients to the log (and wakes up clients waiting for it).
+    void add_past_message(const std::shared_ptr<const EncodedMessage> &message) {
+        message_log.append(message);
     }
 
+    // Claims a player slot for a client matched with the lobby, if it has a slot neither taken
+    // nor claimed. Returns false if it hasn't.
+    bool claim_player_slot(client_id_t client_id);
+    // Gives back the slot claimed by a client (if it has one).
+    void release_player_slot(client_id_t client_id);
+    // Returns the number of players who can still join the game (0 if it started), and stores
+    // in 'unclaimed_slots' how many of their slots aren't claimed.
+    size_t get_free_player_slots(size_t &unclaimed_slots);
+    // Adds a player of a client which sent Join, if the game didn't start and has a free slot.
+    // Claims only steer matchmaking and don't keep other clients from joining, as a client
+    // claiming a slot may only observe. The claim of the client is given back either way.
     void add_player(const Player &player, client_id_t client_id);
     void start_game();
     void initialize_game_state();
-    void run_turn(turn_t turn, std::map<player_id_t, ClientMessage> current_turn_messages);
+    void run_turn(turn_t turn, const TurnMessages &current_turn_messages);
     void end_game();
     void reset_game_state();
 };
@@ -0,0 +1,210 @@
+#ifndef MESSAGE_LOG_H
+#define MESSAGE_LOG_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "../common/messages.h"
+
+// Append-only log of encoded messages sent to clients, shared by all of them. Every client
+// reads it with its own cursor, so a message is stored once however many clients there are,
+// and a client connecting late starts reading at the beginning of the log (its history).
+//
+// The log is kept in segments of a fixed capacity, so that appending a message never moves
+// the messages being read: readers take messages without locks, up to the size of the segment
+// published by the (only) writer. When the log is restarted (a game starts or ends), a new
+// segment begins with the new history, and cursors of connected clients move on to it past
+// that history, which they don't need.
+//
+// Messages are numbered (and their bytes, in the standard encoding, counted) from the beginning
+// of the log, so that the number of messages waiting for a client (not read by its cursor yet)
+// is known.
+class MessageLog {
+private:
+    struct Segment {
+        std::vector<std::shared_ptr<const EncodedMessage>> messages;
+        uint64_t first_message; // Number of messages appended to the log before the segment.
+        uint64_t first_bytes; // Their bytes.
+        std::vector<uint64_t> bytes_through; // Bytes appended to the log up to every message.
+        std::atomic<size_t> size = 0; // Number of messages published.
+        // Set (before 'sealed') when no more messages are appended to the segment.
+        std::shared_ptr<Segment> next;
+        size_t next_start = 0; // Where cursors continue in 'next'.
+        std::atomic<bool> sealed = false;
+
+        explicit Segment(size_t capacity, uint64_t first_message, uint64_t first_bytes) :
+                messages(std::max(capacity, (size_t) 1)), first_message(first_message),
+                first_bytes(first_bytes), bytes_through(messages.size()) {}
+    };
+
+    std::shared_ptr<Segment> current;
+    std::mutex mutex; // Taken to switch 'current' and to start cursors at it.
+    // Incremented after a message is appended (and when a reader has to wake up), readers
+    // wait for it to change.
+    std::atomic<uint64_t> sequence = 0;
+    // Messages appended to the log and their bytes, published after the messages.
+    std::atomic<uint64_t> appended_messages = 0;
+    std::atomic<uint64_t> appended_bytes = 0;
+
+    // Starts a new segment, in which cursors of connected clients continue from 'next_start'.
+    void switch_segment(std::shared_ptr<Segment> segment, size_t next_start) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (current) {
+            current->next = segment;
+            current->next_start = next_start;
+            current->sealed.store(true, std::memory_order_release);
+        }
+        current = std::move(segment);
+    }
+
+public:
+    // Position of a client in the log. It keeps the segment it reads alive.
+    class Cursor {
+    private:
+        friend class MessageLog;
+        std::shared_ptr<Segment> segment;
+        size_t index = 0;
+
+    public:
+        // Returns the number of messages appended to the log before the cursor.
+        [[nodiscard]] uint64_t get_message_position() const {
+            return segment->first_message + index;
+        }
+
+        // Returns the number of bytes of messages appended to the log before the cursor.
+        [[nodiscard]] uint64_t get_byte_position() const {
+            return index == 0 ? segment->first_bytes : segment->bytes_through[index - 1];
+        }
+    };
+
+private:
+    // Moves 'cursor' past the segments it has read (whose next segments have begun) and
+    // returns the number of messages published in its segment.
+    static size_t advance(Cursor &cursor) {
+        while (true) {
+            Segment &segment = *cursor.segment;
+            size_t size = segment.size.load(std::memory_order_acquire);
+            if (cursor.index < size || !segment.sealed.load(std::memory_order_acquire)) {
+                return size;
+            }
+            // Messages may have been appended just before the segment was sealed.
+            size = segment.size.load(std::memory_order_acquire);
+            if (cursor.index < size) {
+                return size;
+            }
+            cursor.index = segment.next_start;
+            cursor.segment = segment.next;
+        }
+    }
+
+public:
+    MessageLog() = default;
+    MessageLog(const MessageLog &) = delete;
+    MessageLog &operator=(const MessageLog &) = delete;
+
+    // Begins a new segment, with room for 'capacity' messages, whose first 'history' messages
+    // (appended right after this call) are read only by clients connecting later.
+    void restart(size_t capacity, size_t history) {
+        switch_segment(std::make_shared<Segment>(capacity, appended_messages, appended_bytes),
+                       history);
+    }
+
+    // Appends a message. Only one thread appends messages.
+    void append(const std::shared_ptr<const EncodedMessage> &message) {
+        Segment *segment = current.get();
+        size_t size = segment->size.load(std::memory_order_relaxed);
+        if (size == segment->messages.size()) {
+            // The segment is full, continue in a twice as large one.
+            switch_segment(std::make_shared<Segment>(2 * size, appended_messages,
+                                                     appended_bytes), 0);
+            segment = current.get();
+            size = 0;
+        }
+        uint64_t bytes = appended_bytes.load(std::memory_order_relaxed) + message->get_length();
+        segment->messages[size] = message;
+        segment->bytes_through[size] = bytes;
+        segment->size.store(size + 1, std::memory_order_release);
+        appended_bytes.store(bytes, std::memory_order_release);
+        appended_messages.fetch_add(1, std::memory_order_release);
+        wake_readers();
+    }
+
+    // Returns a cursor at the beginning of the log.
+    Cursor begin() {
+        std::lock_guard<std::mutex> lock(mutex);
+        Cursor cursor;
+        cursor.segment = current;
+        return cursor;
+    }
+
+    // Takes (without waiting) messages following 'cursor' as long as their total length
+    // doesn't exceed 'max_bytes' (but at least one message), and returns false if there are
+    // none. Messages are taken from a single segment, so they are valid until the next call.
+    bool read(Cursor &cursor, std::vector<const EncodedMessage *> &messages, size_t max_bytes) {
+        size_t size = advance(cursor);
+        if (cursor.index == size) {
+            return false;
+        }
+        Segment &segment = *cursor.segment;
+        size_t bytes = 0;
+        do {
+            const EncodedMessage *message = segment.messages[cursor.index].get();
+            if (!messages.empty() && bytes + message->get_length() > max_bytes) {
+                break;
+            }
+            bytes += message->get_length();
+            messages.push_back(message);
+            cursor.index++;
+        } while (cursor.index < size);
+        return true;
+    }
+
+    // Returns true if there are messages following 'cursor'.
+    [[nodiscard]] bool has_messages(const Cursor &cursor) const {
+        const Segment *segment = cursor.segment.get();
+        size_t index = cursor.index;
+        while (true) {
+            if (index < segment->size.load(std::memory_order_acquire)) {
+                return true;
+            }
+            if (!segment->sealed.load(std::memory_order_acquire)) {
+                return false;
+            }
+            if (index < segment->size.load(std::memory_order_acquire)) {
+                return true;
+            }
+            index = segment->next_start;
+            segment = segment->next.get();
+        }
+    }
+
+    // Returns the number of messages appended to the log.
+    [[nodiscard]] uint64_t get_appended_messages() const {
+        return appended_messages.load(std::memory_order_acquire);
+    }
+
+    // Returns the number of bytes of messages appended to the log.
+    [[nodiscard]] uint64_t get_appended_bytes() const {
+        return appended_bytes.load(std::memory_order_acquire);
+    }
+
+    // Returns the value to be passed to 'wait' before checking for new messages with 'read'.
+    [[nodiscard]] uint64_t get_sequence() const {
+        return sequence.load(std::memory_order_acquire);
+    }
+
+    // Waits until a message is appended (or a reader is woken up) after 'get_sequence' returned
+    // 'seen_sequence'.
+    void wait(uint64_t seen_sequence) const {
+        sequence.wait(seen_sequence, std::memory_order_acquire);
+    }
+
+    // Wakes up all waiting readers (also used when a connection of one of them is closed).
+    void wake_readers() {
+        sequence.fetch_add(1, std::memory_order_release);
+        sequence.notify_all();
+    }
+};
+
+#endif //MESSAGE_LOG_H
@@ -1,7 +1,8 @@
 #ifndef MESSAGE_RECEIVER_H
 #define MESSAGE_RECEIVER_H
 
-#include "game_manager.h"
+#include "../common/socket_buffer.h"
+#include "connection.h"
 #include <utility>
 
 namespace as = boost::asio;
@@ -11,51 +12,35 @@ class MessageReceiver {
 private:
     std::shared_ptr<as::ip::tcp::socket> client_socket;
     std::string client_address;
-    client_id_t client_id;
-    GameManager &game_manager;
-    ClientMessage &newest_message;
-    bool &new_message;
-    std::mutex &new_message_mutex;
+    const ServerOptions &options;
+    Connection &connection;
+
+    void print_statistics(const BufferTCP &buffer) {
+        if (options.statistics) {
+            buffer.print_statistics(std::cerr, "Client " + client_address);
+        }
+    }
 
 public:
     explicit MessageReceiver(std::shared_ptr<as::ip::tcp::socket> client_socket,
-                             std::string client_address, client_id_t client_id,
-                             GameManager &game_manager, ClientMessage &newest_message,
-                             bool &new_message, std::mutex &new_message_mutex) :
+                             std::string client_address, const ServerOptions &options,
+                             Connection &connection) :
             client_socket(std::move(client_socket)), client_address(std::move(client_address)),
-            client_id(client_id), game_manager(game_manager), newest_message(newest_message),
-            new_message(new_message), new_message_mutex(new_message_mutex) {}
+            options(options), connection(connection) {}
 
     void receive_messages() {
+        BufferTCP buffer(*client_socket);
         try {
-            BufferTCP buffer(*client_socket);
             do {
                 ClientMessage client_message(buffer);
-                if (!client_message.is_correct()) {
-                    // Client needs to be disconnected.
-                    throw std::invalid_argument("Incorrect message from client");
-                }
-                switch (client_message.get_type()) {
-                    case ClientMessageType::Join: {
-                        Player player(client_message.get_player_name(), client_address);
-                        game_manager.add_player(player, client_id);
-                        break;
-                    }
-                    case ClientMessageType::PlaceBomb:
-                    case ClientMessageType::PlaceBlock:
-                    case ClientMessageType::Move: {
-                        {
-                            std::lock_guard<std::mutex> lock(new_message_mutex);
-                            newest_message = client_message;
-                            new_message = true;
-                        }
-                        break;
-                    }
-                }
+                buffer.count_received_message();
+                connection.receive_message(client_message);
             } while (true);
         } catch (std::exception &e) {
+            print_statistics(buffer);
             throw;
         } catch (...) {
+            print_statistics(buffer);
             throw;
         }
     }
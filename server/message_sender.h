@@ -1,9 +1,12 @@
 #ifndef MESSAGE_SENDER_H
 #define MESSAGE_SENDER_H
 
+#include <array>
+#include <atomic>
 #include <utility>
-#include "blocking_queue.h"
-#include "game_manager.h"
+#include "../common/socket_buffer.h"
+#include "client_queue.h"
+#include "server_options.h"
 
 namespace as = boost::asio;
 
@@ -11,27 +14,87 @@ namespace as = boost::asio;
 class MessageSender {
 private:
     std::shared_ptr<as::ip::tcp::socket> client_socket;
-    std::shared_ptr<BlockingMessageQueue> messages;
-    GameState &game_state;
+    std::string client_address;
+    ClientQueue &client_queue;
+    MessageLog &message_log;
+    const ServerOptions &options;
+    std::atomic<bool> &compact_encoding;
+    std::atomic<bool> closed = false;
+    // Sending statistics.
+    uint64_t write_syscalls = 0;
+    uint64_t messages_sent = 0;
+    // Number of messages, bytes sent and bytes of these messages in the standard encoding, for
+    // every type of message.
+    static constexpr std::array<const char *, 5> MESSAGE_TYPE_NAMES =
+            {"Hello", "AcceptedPlayer", "GameStarted", "Turn", "GameEnded"};
+    std::array<uint64_t, MESSAGE_TYPE_NAMES.size()> type_messages{};
+    std::array<uint64_t, MESSAGE_TYPE_NAMES.size()> type_bytes_sent{};
+    std::array<uint64_t, MESSAGE_TYPE_NAMES.size()> type_bytes_standard{};
+
+    void print_statistics() const {
+        if (options.statistics) {
+            std::cerr << "Client " << client_address << ": " << messages_sent
+                      << " messages sent with " << write_syscalls << " write syscalls ("
+                      << (write_syscalls > 0 ? (double) messages_sent / (double) write_syscalls : 0)
+                      << " messages per syscall)\n";
+            for (size_t type = 0; type < MESSAGE_TYPE_NAMES.size(); type++) {
+                if (type_messages[type] == 0) {
+                    continue;
+                }
+                std::cerr << "Client " << client_address << ": " << MESSAGE_TYPE_NAMES[type]
+                          << ": " << type_messages[type] << " messages, "
+                          << type_bytes_sent[type] << " bytes sent, "
+                          << type_bytes_standard[type] << " bytes in standard encoding ("
+                          << 100.0 * (1.0 - (double) type_bytes_sent[type] /
+                                            (double) type_bytes_standard[type])
+                          << "% saved)\n";
+            }
+        }
+    }
 
 public:
     explicit MessageSender(std::shared_ptr<as::ip::tcp::socket> client_socket,
-                           GameState &game_state, GameManager &game_manager) :
-            client_socket(std::move(client_socket)), game_state(game_state) {
-        messages = game_manager.get_past_messages();
-    }
+                           std::string client_address, ClientQueue &client_queue,
+                           const ServerOptions &options, std::atomic<bool> &compact_encoding) :
+            client_socket(std::move(client_socket)), client_address(std::move(client_address)),
+            client_queue(client_queue), message_log(client_queue.get_message_log()),
+            options(options), compact_encoding(compact_encoding) {}
 
     void send_messages() {
         try {
-            BufferTCP buffer(*client_socket);
+            std::vector<const EncodedMessage *> server_messages;
+            std::vector<as::const_buffer> buffers;
             do {
-                std::shared_ptr<ServerMessage> server_message = messages->pop();
-                server_message->insert_to_buffer(buffer, game_state);
-                buffer.send_message();
+                // Take all queued messages (up to the byte budget) and, as they are already
+                // encoded, write their bytes with a single scatter-gather write.
+                server_messages.clear();
+                buffers.clear();
+                uint64_t sequence = message_log.get_sequence();
+                if (!client_queue.read(server_messages, options.send_batch_bytes)) {
+                    if (closed) {
+                        throw std::invalid_argument("Connection closed cleanly by peer");
+                    }
+                    message_log.wait(sequence);
+                    continue;
+                }
+                bool compact = compact_encoding;
+                for (auto const & server_message: server_messages) {
+                    buffers.emplace_back(server_message->get_data(compact),
+                                         server_message->get_length(compact));
+                    auto type = static_cast<size_t>(server_message->get_type());
+                    type_messages[type]++;
+                    type_bytes_sent[type] += server_message->get_length(compact);
+                    type_bytes_standard[type] += server_message->get_length();
+                }
+                as::write(*client_socket, buffers);
+                write_syscalls++;
+                messages_sent += server_messages.size();
             } while (true);
         } catch (std::exception &e) {
+            print_statistics();
             close_connection();
         } catch (...) {
+            print_statistics();
             close_connection();
         }
     }
@@ -43,11 +106,8 @@ public:
             // Ignore.
         }
         client_socket->close();
-        messages->close_client_connection();
-    }
-
-    void send_message(const std::shared_ptr<ServerMessage> &server_message) {
-        messages->push(server_message);
+        closed = true;
+        message_log.wake_readers();
     }
 };
 
@@ -1,16 +1,27 @@
+#include <utility> // Needed by Boost.Asio headers on newer compilers.
 #include <boost/asio.hpp>
 #include <boost/program_options.hpp>
 #include <iostream>
 #include "../common/program_options.h"
 #include "../common/messages.h"
+#include "server_options.h"
 #include "server.h"
 
 namespace po = boost::program_options;
 namespace as = boost::asio;
 
+SlowClientPolicy parse_slow_client_policy(const std::string &string, const std::string &option) {
+    if (string == "coalesce") {
+        return SlowClientPolicy::Coalesce;
+    } else if (string != "disconnect") {
+        throw_parsing_error(string, option);
+    }
+    return SlowClientPolicy::Disconnect;
+}
+
 // Prepare the state of the game.
 void parse_variables_map(const po::variables_map &variables_map, GameState &game_state,
-                         port_t &port) {
+                         ServerOptions &options, port_t &port) {
     port = parse(variables_map["port"].as<port_parsing_t>(), "port");
     game_state.bomb_timer = parse(
             variables_map["bomb-timer"].as<bomb_timer_parsing_t>(), "bomb-timer");
@@ -31,6 +42,37 @@ void parse_variables_map(const po::variables_map &variables_map, GameState &game
             variables_map["size-x"].as<coordinate_parsing_t>(), "size-x");
     game_state.size_y = parse(
             variables_map["size-y"].as<coordinate_parsing_t>(), "size-y");
+    game_state.explosion_engine = parse_explosion_engine(
+            variables_map["explosion-engine"].as<std::string>(), "explosion-engine");
+    game_state.resize_board();
+    options.statistics = variables_map["statistics"].as<bool>();
+    options.explosion_threads = parse(
+            variables_map["explosion-threads"].as<explosion_threads_parsing_t>(),
+            "explosion-threads");
+    options.action_threads = parse(
+            variables_map["action-threads"].as<action_threads_parsing_t>(), "action-threads");
+    options.network_threads = parse(
+            variables_map["network-threads"].as<network_threads_parsing_t>(), "network-threads");
+    options.max_connections = parse(
+            variables_map["max-connections"].as<max_connections_parsing_t>(), "max-connections");
+    options.rooms = parse(variables_map["rooms"].as<rooms_parsing_t>(), "rooms");
+    if (options.rooms == 0) {
+        throw po::error("the server has to have at least one room");
+    }
+    options.room_threads = parse(
+            variables_map["room-threads"].as<room_threads_parsing_t>(), "room-threads");
+    options.spin_wait_us = parse(
+            variables_map["spin-wait"].as<spin_wait_parsing_t>(), "spin-wait");
+    options.send_batch_bytes = parse(
+            variables_map["send-batch-bytes"].as<send_batch_bytes_parsing_t>(), "send-batch-bytes");
+    options.max_queued_messages = parse(
+            variables_map["max-queued-messages"].as<max_queued_messages_parsing_t>(),
+            "max-queued-messages");
+    options.max_queued_bytes = parse(
+            variables_map["max-queued-bytes"].as<max_queued_bytes_parsing_t>(),
+            "max-queued-bytes");
+    options.slow_client_policy = parse_slow_client_policy(
+            variables_map["slow-client-policy"].as<std::string>(), "slow-client-policy");
 }
 
 int main(int argc, char **argv) {
@@ -48,22 +90,20 @@ int main(int argc, char **argv) {
 
         notify_variables_map(variables_map);
 
-        GameState game_state;
-        game_state.type = GameStateType::Lobby;
+        GameState rules; // Of games in all rooms.
+        ServerOptions options;
         port_t port;
-        parse_variables_map(variables_map, game_state, port);
+        parse_variables_map(variables_map, rules, options, port);
 
-        Server server(game_state);
+        Server server(rules, options);
         // Start thread responsible for accepting new connections.
         std::thread thread_accepting_clients(
                 [&server, &io_context, &port] {
                     server.accept_clients(io_context, port);
                 });
         try {
-            // Run games in a loop.
-            do {
-                server.run_game();
-            } while (true);
+            // Run games in all rooms in a loop.
+            server.run_rooms();
         } catch (std::exception &e) {
             thread_accepting_clients.join();
         }
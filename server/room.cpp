@@ -0,0 +1,203 @@
+#include <ctime>
+#include <set>
+#include <sstream>
+#include "room.h"
+#include "room_scheduler.h"
+
+namespace {
+    // Returns CPU time used by the calling thread.
+    std::chrono::nanoseconds get_thread_cpu_time() {
+        timespec time{};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+        return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+    }
+}
+
+Room::Room(size_t room_id, const GameState &rules, const ServerOptions &options,
+           const std::atomic<uint64_t> &rejected_connections) :
+        room_id(room_id), options(options), rejected_connections(rejected_connections),
+        game_manager(set_up_game_state(rules), client_to_player_id, pending_messages,
+                     options.explosion_threads, options.action_threads, [this] { wake_up(); }),
+        turn_scheduler(rules.turn_duration) {}
+
+GameState &Room::set_up_game_state(const GameState &rules) {
+    game_state.type = GameStateType::Lobby;
+    game_state.set_rules(rules);
+    // Rooms play different games.
+    game_state.seed = (seed_t) (rules.seed + room_id);
+    game_state.resize_board();
+    return game_state;
+}
+
+void Room::remove_closed_connections() {
+    std::set<client_id_t> clients_to_be_removed;
+    std::lock_guard<std::mutex> lock(clients_mutex);
+    for (auto & [client_id, client_connection]: clients) {
+        if (client_connection->is_closed()) {
+            clients_to_be_removed.insert(client_id);
+        }
+    }
+    for (auto & client_id: clients_to_be_removed) {
+        clients.erase(client_id);
+    }
+}
+
+void Room::send_messages_to_clients() {
+    std::shared_ptr<const EncodedMessage> server_message;
+    bool sent = false;
+    while (pending_messages.try_pop(server_message)) {
+        if (server_message->get_type() == ServerMessageType::AcceptedPlayer) {
+            accepted_players++;
+        }
+        // The message is stored once, in the log read by all clients.
+        game_manager.add_past_message(server_message);
+        sent = true;
+    }
+    if (!sent) {
+        return;
+    }
+    remove_closed_connections();
+    std::lock_guard<std::mutex> lock(clients_mutex);
+    for (auto & [client_id, client_connection]: clients) {
+        if (!client_connection->is_closed()) {
+            uint64_t queued_messages;
+            uint64_t queued_bytes;
+            client_connection->get_client_queue().get_depth(queued_messages, queued_bytes);
+            client_queue_metrics.add_sample(queued_messages, queued_bytes);
+            client_connection->notify_new_messages();
+        }
+    }
+}
+
+void Room::collect_player_connections() {
+    player_connections.clear();
+    // Players without a connection (closed in the lobby) don't act in this game, so they can't
+    // keep the last messages of a previous one.
+    last_messages = TurnMessages();
+    std::lock_guard<std::mutex> lock(clients_mutex);
+    for (auto const & [client_id, player_id]: client_to_player_id) {
+        auto client = clients.find(client_id);
+        if (client != clients.end()) {
+            player_connections.emplace_back(player_id, client->second);
+        }
+    }
+}
+
+// Takes the newest message of every player (with one atomic exchange, without locks).
+void Room::collect_last_messages() {
+    for (auto const & [player_id, client_connection]: player_connections) {
+        last_messages[player_id] = client_connection->take_newest_input();
+    }
+}
+
+// Discards messages sent by players before the current turn.
+void Room::reset_last_messages() {
+    for (auto const & [player_id, client_connection]: player_connections) {
+        client_connection->take_newest_input();
+    }
+}
+
+size_t Room::get_open_connections() {
+    std::lock_guard<std::mutex> lock(clients_mutex);
+    return (size_t) std::count_if(clients.begin(), clients.end(), [](auto const &client) {
+        return !client.second->is_closed();
+    });
+}
+
+// Sends AcceptedPlayer messages and starts the game once all players joined (and their
+// AcceptedPlayer messages were sent). Until then, the room waits for the next player to join.
+Room::clock::time_point Room::run_lobby() {
+    send_messages_to_clients();
+    if (accepted_players < game_state.players_count) {
+        return clock::time_point::max();
+    }
+    turns = 0;
+    allocating_turns = 0;
+    turn_allocations = 0;
+    cpu_time = std::chrono::nanoseconds::zero();
+    client_queue_metrics.reset();
+    game_manager.start_game();
+    send_messages_to_clients(); // GameStarted.
+    collect_player_connections();
+    game_manager.initialize_game_state();
+    send_messages_to_clients(); // Turn.
+    reset_last_messages();
+    turn_scheduler.start_game();
+    turn = 1;
+    if (turn > game_state.game_length) {
+        return end_game();
+    }
+    return turn_scheduler.get_deadline(turn);
+}
+
+Room::clock::time_point Room::run_turn() {
+    turn_scheduler.start_turn(turn);
+    uint64_t allocations = get_allocations();
+    collect_last_messages();
+    game_manager.run_turn(turn, last_messages);
+    send_messages_to_clients(); // Turn.
+    allocations = get_allocations() - allocations;
+    turns++;
+    allocating_turns += allocations > 0 ? 1 : 0;
+    turn_allocations += allocations;
+    if (turn < game_state.game_length) {
+        turn++;
+        return turn_scheduler.get_deadline(turn);
+    }
+    return end_game();
+}
+
+Room::clock::time_point Room::end_game() {
+    game_manager.end_game();
+    send_messages_to_clients(); // GameEnded.
+    print_statistics();
+    game_manager.reset_game_state();
+    player_connections.clear();
+    accepted_players = 0;
+    turn = TURN_ZERO;
+    return clock::now();
+}
+
+void Room::print_statistics() {
+    if (!options.statistics) {
+        return;
+    }
+    // Lines of a room are printed at once, as rooms are run by many threads.
+    std::string prefix = "Room " + std::to_string(room_id) + ": ";
+    std::ostringstream out;
+    std::chrono::nanoseconds game_cpu_time = cpu_time + get_thread_cpu_time() - step_cpu_time;
+    out << prefix << "Turn loop: " << turns << " turns, " << allocating_turns
+        << " of them allocating memory (" << turn_allocations << " allocations), "
+        << game_cpu_time.count() / 1000 << " us of CPU time ("
+        << (turns > 0 ? (uint64_t) game_cpu_time.count() / 1000 / turns : 0) << " us per turn)\n";
+    turn_scheduler.print_statistics(out, prefix);
+    client_queue_metrics.print(out, prefix);
+    size_t connections = 0;
+    size_t memory = 0;
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        for (auto const & [client_id, client_connection]: clients) {
+            if (!client_connection->is_closed()) {
+                connections++;
+                memory += client_connection->get_memory_usage();
+            }
+        }
+    }
+    out << prefix << "Connections: " << connections << " open, " << rejected_connections
+        << " rejected in the server, " << (connections > 0 ? memory / connections : 0)
+        << " bytes of memory per connection (" << memory << " in total)\n";
+    std::cerr << out.str();
+}
+
+void Room::wake_up() {
+    if (scheduler) {
+        scheduler->wake_up(*this);
+    }
+}
+
+Room::clock::time_point Room::run_step() {
+    step_cpu_time = get_thread_cpu_time();
+    clock::time_point next_step = turn == TURN_ZERO ? run_lobby() : run_turn();
+    cpu_time += get_thread_cpu_time() - step_cpu_time;
+    return next_step;
+}
@@ -0,0 +1,94 @@
+#ifndef ROOM_H
+#define ROOM_H
+
+#include <chrono>
+#include <utility>
+#include "../common/allocation_counter.h"
+#include "connection.h"
+#include "game_manager.h"
+#include "server_options.h"
+#include "turn_scheduler.h"
+
+class RoomScheduler;
+
+// A game hosted by the server, with its own state, clients and turn loop. The turn loop doesn't
+// wait for anything: it runs in steps (a turn, or checking the lobby), each of which returns when
+// the next one is due, and RoomScheduler runs steps of all rooms on a pool of threads. Steps of
+// a room never run at once. A lobby has no next step due until a player joins it, which wakes
+// the room up.
+class Room {
+private:
+    using clock = std::chrono::steady_clock;
+
+    size_t room_id;
+    const ServerOptions &options;
+    const std::atomic<uint64_t> &rejected_connections; // Of the whole server.
+    GameState game_state;
+    std::map<client_id_t, std::shared_ptr<Connection>> clients;
+    std::mutex clients_mutex; // Clients are added by the thread accepting them.
+    std::map<client_id_t, player_id_t> client_to_player_id;
+    BlockingMessageQueue pending_messages; // Encoded messages to be sent to clients.
+    GameManager game_manager;
+    size_t accepted_players = 0; // AcceptedPlayer messages sent in the lobby.
+    turn_t turn = TURN_ZERO; // The next turn of the game (0 in Lobby state).
+    // Connections of players of the current game (taken when it starts, as players don't change
+    // during a game) and their last messages of a turn, indexed by player ids.
+    std::vector<std::pair<player_id_t, std::shared_ptr<Connection>>> player_connections;
+    TurnMessages last_messages;
+    TurnScheduler turn_scheduler;
+    ClientQueueMetrics client_queue_metrics; // Of the current game.
+    // Turn loop statistics of the current game: turns, turns which allocated memory and their
+    // allocations, and CPU time of steps of the room.
+    uint64_t turns = 0;
+    uint64_t allocating_turns = 0;
+    uint64_t turn_allocations = 0;
+    std::chrono::nanoseconds cpu_time{};
+    std::chrono::nanoseconds step_cpu_time{}; // CPU time of the thread when the step started.
+    // Set by RoomScheduler running the room, before clients connect.
+    RoomScheduler *scheduler = nullptr;
+    // The room was woken up while its step was running (see RoomScheduler::wake_up).
+    std::atomic<bool> woken_up = false;
+
+    friend class RoomScheduler;
+
+    // Sets parameters of the game from 'rules' (before 'game_manager' is constructed).
+    GameState &set_up_game_state(const GameState &rules);
+    void remove_closed_connections();
+    void send_messages_to_clients();
+    void collect_player_connections();
+    void collect_last_messages();
+    void reset_last_messages();
+    // Steps of the turn loop, returning when the next one is due.
+    clock::time_point run_lobby();
+    clock::time_point run_turn();
+    clock::time_point end_game();
+    void print_statistics();
+    // Makes the next step of the room due now (called when a player joins its lobby).
+    void wake_up();
+
+public:
+    explicit Room(size_t room_id, const GameState &rules, const ServerOptions &options,
+                  const std::atomic<uint64_t> &rejected_connections);
+    Room(const Room &) = delete;
+    Room &operator=(const Room &) = delete;
+
+    GameManager &get_game_manager() {
+        return game_manager;
+    }
+
+    ClientQueueMetrics &get_client_queue_metrics() {
+        return client_queue_metrics;
+    }
+
+    void add_client(client_id_t client_id, std::shared_ptr<Connection> client_connection) {
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        clients[client_id] = std::move(client_connection);
+    }
+
+    [[nodiscard]] size_t get_open_connections();
+
+    // Runs the next step of the turn loop and returns when the next one is due.
+    clock::time_point run_step();
+};
+
+#endif //ROOM_H
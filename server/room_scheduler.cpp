@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <thread>
+#include "room_scheduler.h"
+
+RoomScheduler::RoomScheduler(const std::vector<std::unique_ptr<Room>> &rooms, size_t threads,
+                             uint64_t spin_wait_us) :
+        spin_duration(std::chrono::microseconds(spin_wait_us)) {
+    threads = std::max(threads, (size_t) 1);
+    for (size_t worker_id = 0; worker_id < threads; worker_id++) {
+        workers.push_back(std::make_unique<Worker>());
+        workers.back()->rooms.reserve(rooms.size());
+    }
+    // Rooms are dealt to threads, with their first steps due now.
+    clock::time_point now = clock::now();
+    for (size_t room_id = 0; room_id < rooms.size(); room_id++) {
+        workers[room_id % threads]->rooms.emplace_back(now, rooms[room_id].get());
+        rooms[room_id]->scheduler = this;
+    }
+}
+
+bool RoomScheduler::take_due_room(Worker &worker, clock::time_point now, Room *&room,
+                                  clock::time_point &step_time) {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.rooms.empty() || worker.rooms.front().first - spin_duration > now) {
+        return false;
+    }
+    std::pop_heap(worker.rooms.begin(), worker.rooms.end(), is_later);
+    step_time = worker.rooms.back().first;
+    room = worker.rooms.back().second;
+    worker.rooms.pop_back();
+    return true;
+}
+
+void RoomScheduler::put_room(Worker &worker, Room *room, clock::time_point step_time) {
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        // The room was woken up while running, when it wasn't in any queue.
+        if (room->woken_up.exchange(false)) {
+            step_time = std::min(step_time, clock::now());
+        }
+        worker.rooms.emplace_back(step_time, room);
+        std::push_heap(worker.rooms.begin(), worker.rooms.end(), is_later);
+    }
+    notify_room_queued(step_time);
+}
+
+void RoomScheduler::notify_room_queued(clock::time_point step_time) {
+    bool wake_up;
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        rooms_queued++;
+        wake_up = sleeping > 0 && step_time < wakeup_time;
+    }
+    if (wake_up) {
+        room_queued.notify_all();
+    }
+}
+
+void RoomScheduler::wake_up(Room &room) {
+    clock::time_point now = clock::now();
+    {
+        // With all queues locked, the room is either in one of them or running its step (and
+        // it is put back after this, seeing 'woken_up').
+        std::vector<std::unique_lock<std::mutex>> locks;
+        for (auto const & worker: workers) {
+            locks.emplace_back(worker->mutex);
+        }
+        bool queued = false;
+        for (auto const & worker: workers) {
+            for (QueuedRoom &queued_room: worker->rooms) {
+                if (queued_room.second == &room) {
+                    queued_room.first = std::min(queued_room.first, now);
+                    std::make_heap(worker->rooms.begin(), worker->rooms.end(), is_later);
+                    queued = true;
+                    break;
+                }
+            }
+        }
+        if (!queued) {
+            room.woken_up = true;
+        }
+    }
+    notify_room_queued(now);
+}
+
+RoomScheduler::clock::time_point RoomScheduler::get_first_step_time() {
+    clock::time_point first_step_time = clock::time_point::max();
+    for (auto const & worker: workers) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        if (!worker->rooms.empty()) {
+            first_step_time = std::min(first_step_time, worker->rooms.front().first);
+        }
+    }
+    return first_step_time;
+}
+
+void RoomScheduler::run_worker(size_t worker_id) {
+    Worker &own_worker = *workers[worker_id];
+    while (!stopped) {
+        clock::time_point now = clock::now();
+        Room *room = nullptr;
+        clock::time_point step_time;
+        // Run own rooms first, and steal a room only if none of them is due.
+        bool taken = take_due_room(own_worker, now, room, step_time);
+        for (size_t i = 1; !taken && i < workers.size(); i++) {
+            taken = take_due_room(*workers[(worker_id + i) % workers.size()], now, room,
+                                  step_time);
+        }
+        if (taken) {
+            while (clock::now() < step_time) {
+                // Spin.
+            }
+            put_room(own_worker, room, room->run_step());
+            continue;
+        }
+
+        uint64_t seen_rooms_queued;
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            seen_rooms_queued = rooms_queued;
+        }
+        // Rooms being run aren't in any queue, they are put back (waking this thread up if
+        // their next steps are earlier) when their steps end.
+        clock::time_point first_step_time = get_first_step_time();
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        auto woken_up = [&] {
+            return stopped || rooms_queued != seen_rooms_queued;
+        };
+        wakeup_time = sleeping == 0 ? first_step_time : std::max(wakeup_time, first_step_time);
+        sleeping++;
+        if (first_step_time == clock::time_point::max()) {
+            room_queued.wait(lock, woken_up);
+        } else {
+            room_queued.wait_until(lock, first_step_time - spin_duration, woken_up);
+        }
+        sleeping--;
+    }
+}
+
+void RoomScheduler::run() {
+    auto run_worker_safely = [this](size_t worker_id) {
+        try {
+            run_worker(worker_id);
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                stopped = true;
+            }
+            room_queued.notify_all();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t worker_id = 1; worker_id < workers.size(); worker_id++) {
+        threads.emplace_back(run_worker_safely, worker_id);
+    }
+    run_worker_safely(0);
+    for (auto & thread: threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
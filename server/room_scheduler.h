@@ -0,0 +1,75 @@
+#ifndef ROOM_SCHEDULER_H
+#define ROOM_SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "room.h"
+
+// Runs steps of rooms on a pool of threads, each step when it is due. Every thread has its own
+// queue of rooms ordered by the time of their next steps, and runs them, so threads don't
+// contend for a single queue. A thread with no room due steals a room due from another thread
+// (busy with a room of its own), after which the room stays in the queue of the thief. The last
+// microseconds before a step can be spent spinning instead of sleeping, as a thread woken up by
+// the system can be late. A room with no step due (a lobby waiting for players) is woken up by
+// the thread adding a player.
+class RoomScheduler {
+private:
+    using clock = std::chrono::steady_clock;
+
+    using QueuedRoom = std::pair<clock::time_point, Room *>; // Time of its next step.
+
+    struct Worker {
+        std::mutex mutex;
+        // Heap of rooms with the first step on top (with room for all rooms, so that putting a
+        // room back doesn't allocate memory).
+        std::vector<QueuedRoom> rooms;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    clock::duration spin_duration;
+    // Idle threads sleep until the first step of all rooms, and are woken up when a room is put
+    // back with an earlier step. Fields below are guarded by 'sleep_mutex'.
+    std::mutex sleep_mutex;
+    std::condition_variable room_queued;
+    uint64_t rooms_queued = 0; // Number of times a room was put back.
+    size_t sleeping = 0;
+    clock::time_point wakeup_time; // Of all sleeping threads (or later).
+    std::atomic<bool> stopped = false;
+    std::exception_ptr error; // Thrown by a step.
+
+    // Orders a heap of rooms with the first step on top.
+    static bool is_later(const QueuedRoom &room, const QueuedRoom &other_room) {
+        return room.first > other_room.first;
+    }
+    // Takes a room of 'worker' whose step is due (or due within the spin duration).
+    bool take_due_room(Worker &worker, clock::time_point now, Room *&room,
+                       clock::time_point &step_time);
+    void put_room(Worker &worker, Room *room, clock::time_point step_time);
+    // Wakes up sleeping threads if a room was queued with a step before their wakeup time.
+    void notify_room_queued(clock::time_point step_time);
+    // Returns the time of the first step of all rooms.
+    clock::time_point get_first_step_time();
+    void run_worker(size_t worker_id);
+
+public:
+    // Makes a pool of 'threads' threads running 'rooms'.
+    explicit RoomScheduler(const std::vector<std::unique_ptr<Room>> &rooms, size_t threads,
+                           uint64_t spin_wait_us);
+    RoomScheduler(const RoomScheduler &) = delete;
+    RoomScheduler &operator=(const RoomScheduler &) = delete;
+
+    // Makes the next step of 'room' due now. If the room is running its step, it runs again
+    // right after it.
+    void wake_up(Room &room);
+
+    // Runs rooms on the calling thread and the other threads of the pool, until a step throws
+    // (the exception is rethrown by the calling thread).
+    void run();
+};
+
+#endif //ROOM_SCHEDULER_H
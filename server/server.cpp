@@ -1,80 +1,129 @@
+#include <tuple>
 #include "server.h"
 
-void Server::remove_closed_connections() {
-    std::set<client_id_t> clients_to_be_removed;
-    for (auto & [client_id, client_connection]: clients) {
-        if (client_connection.is_closed()) {
-            clients_to_be_removed.insert(client_id);
-        }
-    }
-    for (auto & client_id: clients_to_be_removed) {
-        clients.erase(client_id);
-    }
-}
-
-void Server::send_message_to_clients() {
-    std::shared_ptr<ServerMessage> server_message = pending_messages.pop();
-    game_manager.add_past_message(server_message);
-    remove_closed_connections();
-    for (auto & [client_id, client_connection]: clients) {
-        if (!client_connection.is_closed()) {
-            client_connection.send_message(server_message);
-        }
+Server::Server(const GameState &rules, const ServerOptions &options) : options(options) {
+    for (size_t room_id = 0; room_id < options.rooms; room_id++) {
+        rooms.push_back(std::make_unique<Room>(room_id, rules, options, rejected_connections));
     }
+    room_scheduler = std::make_unique<RoomScheduler>(rooms, options.room_threads,
+                                                     options.spin_wait_us);
 }
 
-std::map<player_id_t, ClientMessage> Server::collect_last_messages() {
-    std::map<player_id_t, ClientMessage> last_messages;
-    for (auto & [client_id, client]: clients) {
-        if (client_to_player_id.contains(client_id) && client.has_a_new_message()) {
-            player_id_t player_id = client_to_player_id[client_id];
-            last_messages[player_id] = client.get_newest_message();
-        }
+bool Server::can_accept_connection(as::ip::tcp::socket &client_socket) {
+    size_t connections = 0;
+    for (auto const & room: rooms) {
+        connections += room->get_open_connections();
     }
-    return last_messages;
-}
-
-void Server::reset_last_messages() {
-    for (auto & [client_id, client_connection]: clients) {
-        if (client_connection.has_a_new_message()) {
-            client_connection.reset_newest_message();
-        }
+    if (connections < options.max_connections) {
+        return true;
     }
+    rejected_connections++;
+    boost::system::error_code error;
+    client_socket.close(error);
+    return false;
 }
 
 void Server::accept_clients(as::io_context &io_context, port_t port) {
+    if (options.network_threads > 0) {
+        accept_clients_async(io_context, port);
+        return;
+    }
     as::ip::tcp::acceptor tcp_acceptor(io_context,
                                        as::ip::tcp::endpoint(as::ip::tcp::v6(), port));
     do {
         auto client_socket = std::make_shared<as::ip::tcp::socket>(io_context);
         tcp_acceptor.accept(*client_socket);
+        if (!can_accept_connection(*client_socket)) {
+            continue;
+        }
         (*client_socket).set_option(as::ip::tcp::no_delay(true));
         std::ostringstream client_address;
         client_address << (*client_socket).remote_endpoint();
         client_id_t client_id = client_id_generator.generate_id();
-        auto [iterator, insertion_success] =
-                clients.try_emplace(client_id, client_socket, client_address.str(),
-                                    client_id, game_state, game_manager);
-        ClientConnection &client_connection = iterator->second;
+        Room &room = match_room(client_id);
+        auto client_connection = std::make_shared<ClientConnection>(
+                client_socket, client_address.str(), client_id, room.get_game_manager(),
+                options, room.get_client_queue_metrics());
+        room.add_client(client_id, client_connection);
         std::thread thread_client(
-                [&client_connection] {
+                [&client_connection = *client_connection] {
                     client_connection.send_and_receive_messages();
                 });
-        client_connection.set_thread_client(std::move(thread_client));
+        client_connection->set_thread_client(std::move(thread_client));
     } while (true);
 }
 
-void Server::run_game() {
-    collect_players();
-    start_game();
-    initialize_game_state();
-    reset_last_messages();
-    for (turn_t turn = 1; turn <= game_state.game_length; turn++) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(game_state.turn_duration));
-        std::map<player_id_t, ClientMessage> last_messages = collect_last_messages();
-        run_turn(turn, last_messages);
-        reset_last_messages();
+void Server::accept_clients_async(as::io_context &io_context, port_t port) {
+    as::ip::tcp::acceptor tcp_acceptor(io_context,
+                                       as::ip::tcp::endpoint(as::ip::tcp::v6(), port));
+    std::function<void()> accept = [&] {
+        tcp_acceptor.async_accept([&](const boost::system::error_code &error,
+                                      as::ip::tcp::socket client_socket) {
+            if (!error && can_accept_connection(client_socket)) {
+                boost::system::error_code socket_error;
+                client_socket.set_option(as::ip::tcp::no_delay(true), socket_error);
+                auto endpoint = client_socket.remote_endpoint(socket_error);
+                if (!socket_error) {
+                    std::ostringstream client_address;
+                    client_address << endpoint;
+                    client_id_t client_id = client_id_generator.generate_id();
+                    Room &room = match_room(client_id);
+                    auto client_connection = std::make_shared<AsyncConnection>(
+                            io_context, std::move(client_socket), client_address.str(),
+                            client_id, room.get_game_manager(), options,
+                            room.get_client_queue_metrics());
+                    room.add_client(client_id, client_connection);
+                    client_connection->start();
+                }
+            }
+            accept();
+        });
+    };
+    accept();
+    // Serve all connections with a pool of threads.
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < options.network_threads; i++) {
+        threads.emplace_back([&io_context] { io_context.run(); });
+    }
+    io_context.run();
+    for (auto & thread: threads) {
+        thread.join();
+    }
+}
+
+Room &Server::match_room(client_id_t client_id) {
+    // Lobbies are compared by whether they have unclaimed slots, then by the slots left and
+    // by connections, the smaller the better.
+    Room *lobby = nullptr;
+    std::tuple<bool, size_t, size_t> lobby_order;
+    Room *room = nullptr;
+    size_t room_connections = 0;
+    for (auto const & candidate: rooms) {
+        GameManager &game_manager = candidate->get_game_manager();
+        size_t unclaimed_slots;
+        size_t free_slots = game_manager.get_free_player_slots(unclaimed_slots);
+        size_t connections = candidate->get_open_connections();
+        std::tuple<bool, size_t, size_t> order(unclaimed_slots == 0,
+                                               unclaimed_slots > 0 ? unclaimed_slots : free_slots,
+                                               connections);
+        if (free_slots > 0 && (!lobby || order < lobby_order)) {
+            lobby = candidate.get();
+            lobby_order = order;
+        }
+        if (!room || connections < room_connections) {
+            room = candidate.get();
+            room_connections = connections;
+        }
+    }
+    if (lobby) {
+        // Fails (leaving the client without a claim) if other clients claimed or took the last
+        // unclaimed slots in the meantime.
+        lobby->get_game_manager().claim_player_slot(client_id);
+        return *lobby;
     }
-    end_game();
-    reset_game_state();
-}
\ No newline at end of file
+    return *room;
+}
+
+void Server::run_rooms() {
+    room_scheduler->run();
+}
@@ -1,74 +1,42 @@
 #ifndef SERVER_MANAGER_H
 #define SERVER_MANAGER_H
 
+#include <functional>
 #include <utility>
 
+#include "async_connection.h"
 #include "client_connection.h"
-#include "game_manager.h"
+#include "room.h"
+#include "room_scheduler.h"
+#include "server_options.h"
 
+// Accepts connections and hosts games in rooms, run by RoomScheduler.
 class Server {
 private:
-    GameState &game_state;
-    std::map<client_id_t, ClientConnection> clients;
+    const ServerOptions &options;
+    std::vector<std::unique_ptr<Room>> rooms;
+    std::unique_ptr<RoomScheduler> room_scheduler; // Made before clients connect (they wake it).
+    std::atomic<uint64_t> rejected_connections = 0; // Over the limit of connections.
     IdGenerator<client_id_t> client_id_generator;
-    std::map<client_id_t, player_id_t> client_to_player_id;
-    BlockingMessageQueue pending_messages; // Messages to be sent to clients.
-    GameManager game_manager;
 
-    void remove_closed_connections();
-    void send_message_to_clients();
-    std::map<player_id_t, ClientMessage> collect_last_messages();
-    void reset_last_messages();
-
-    void collect_players() {
-        bool players_collected = false;
-        {
-            std::lock_guard <std::mutex> lock(game_state.mutex);
-            if (game_state.players_count == game_state.players.size()) {
-                players_collected = true;
-            }
-        }
-        while (!players_collected) {
-            send_message_to_clients();
-            {
-                std::lock_guard <std::mutex> lock(game_state.mutex);
-                if (game_state.players_count == game_state.players.size()) {
-                    players_collected = true;
-                }
-            }
-        }
-    }
-
-    void start_game() {
-        game_manager.start_game();
-        send_message_to_clients(); // GameStarted.
-    }
-
-    void initialize_game_state() {
-        game_manager.initialize_game_state();
-        send_message_to_clients(); // Turn.
-    }
-
-    void run_turn(turn_t turn, std::map<player_id_t, ClientMessage> last_messages) {
-        game_manager.run_turn(turn, std::move(last_messages));
-        send_message_to_clients(); // Turn.
-    }
-
-    void end_game() {
-        game_manager.end_game();
-        send_message_to_clients(); // GameEnded.
-    }
-
-    void reset_game_state() {
-        game_manager.reset_game_state();
-    }
+    // Returns false (and closes the socket) if there are too many connections already.
+    bool can_accept_connection(as::ip::tcp::socket &client_socket);
+    // Matchmaking: returns the room of a new connection of client 'client_id'. It is the room in
+    // Lobby state with the fewest free player slots (but some), so that lobbies fill one by one
+    // and games start as soon as possible, or the room with the fewest connections if no lobby
+    // has a free slot (the client joins its next game). The client claims a slot in the lobby
+    // it is matched with, and slots claimed by other clients count as taken, so that clients
+    // connecting at once are spread over lobbies. Only if no lobby has unclaimed slots, the
+    // client is matched with a lobby without claiming one (it may only observe the game).
+    Room &match_room(client_id_t client_id);
+    void accept_clients_async(as::io_context &io_context, port_t port);
 
 public:
-    explicit Server(GameState &game_state) :
-            game_state(game_state), game_manager(game_state, client_to_player_id, pending_messages) {}
+    explicit Server(const GameState &rules, const ServerOptions &options);
 
     void accept_clients(as::io_context &io_context, port_t port);
-    void run_game();
+    // Runs games in all rooms (until a game throws).
+    void run_rooms();
 };
 
 #endif //SERVER_MANAGER_H
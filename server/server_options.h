@@ -0,0 +1,36 @@
+#ifndef SERVER_OPTIONS_H
+#define SERVER_OPTIONS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// What happens to a client which falls too far behind the messages sent to it.
+enum class SlowClientPolicy {
+    Disconnect, // Its connection is closed.
+    // Runs of queued Turn messages are sent as single Turn messages, where the state of the
+    // client after them is the same (see EncodedMessage). Its connection is closed anyway once
+    // it is far over the limit (see ClientQueue).
+    Coalesce,
+};
+
+// Server parameters not related to the rules of the game.
+struct ServerOptions {
+    bool statistics = false; // Print performance statistics to standard error.
+    size_t send_batch_bytes = 65536; // Maximum length of messages sent with one write.
+    size_t explosion_threads = 1; // Threads calculating explosions of a turn.
+    size_t action_threads = 1; // Threads evaluating actions of players of a turn.
+    // Threads serving all connections asynchronously (0 for two threads of every connection).
+    size_t network_threads = 0;
+    size_t max_connections = 1024; // Further connections are closed right after accepting.
+    size_t rooms = 1; // Rooms hosting games at once.
+    size_t room_threads = 1; // Threads running turns of all rooms.
+    uint64_t spin_wait_us = 0; // Spent spinning (instead of sleeping) before a turn starts.
+    // Limits of messages (and their bytes) waiting to be sent to a client (0 for no limit), over
+    // which 'slow_client_policy' applies. They have to leave room for all messages of a step of
+    // the room (like AcceptedPlayer messages of all players joining at once).
+    uint64_t max_queued_messages = 0;
+    uint64_t max_queued_bytes = 0;
+    SlowClientPolicy slow_client_policy = SlowClientPolicy::Disconnect;
+};
+
+#endif //SERVER_OPTIONS_H
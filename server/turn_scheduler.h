@@ -0,0 +1,94 @@
+#ifndef TURN_SCHEDULER_H
+#define TURN_SCHEDULER_H
+
+#include <array>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include "../common/types.h"
+
+// Deadlines of turns of a game: turn 'n' starts 'n' turn durations after the game, however long
+// previous turns took, so that time spent running turns doesn't add up. Waiting for them is up
+// to RoomScheduler. Lateness of turns is kept in a histogram.
+class TurnScheduler {
+private:
+    using clock = std::chrono::steady_clock;
+
+    // Bucket 0 counts turns late by less than 1 us, bucket 'i' by [2^(i-1), 2^i) us, and the
+    // last one by more.
+    static constexpr size_t BUCKETS = 20;
+
+    clock::duration turn_duration;
+    clock::time_point start;
+    clock::time_point last_turn_start;
+    std::array<uint64_t, BUCKETS> lateness_histogram{};
+    uint64_t turns = 0;
+    clock::duration total_lateness{};
+    clock::duration max_lateness{};
+
+    static size_t get_bucket(uint64_t lateness_us) {
+        size_t bucket = 0;
+        while (lateness_us > 0 && bucket < BUCKETS - 1) {
+            lateness_us >>= 1;
+            bucket++;
+        }
+        return bucket;
+    }
+
+    static uint64_t to_us(clock::duration duration) {
+        return (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    }
+
+public:
+    explicit TurnScheduler(turn_duration_t turn_duration_ms) :
+            turn_duration(std::chrono::milliseconds(turn_duration_ms)) {}
+
+    // Starts a game: its turn 0 starts now.
+    void start_game() {
+        start = clock::now();
+        last_turn_start = start;
+        lateness_histogram.fill(0);
+        turns = 0;
+        total_lateness = clock::duration::zero();
+        max_lateness = clock::duration::zero();
+    }
+
+    [[nodiscard]] clock::time_point get_deadline(turn_t turn) const {
+        return start + turn * turn_duration;
+    }
+
+    // Records how late 'turn' starts (now).
+    void start_turn(turn_t turn) {
+        clock::time_point deadline = get_deadline(turn);
+        last_turn_start = clock::now();
+        clock::duration lateness = last_turn_start - deadline;
+        lateness_histogram[get_bucket(to_us(lateness))]++;
+        turns++;
+        total_lateness += lateness;
+        max_lateness = std::max(max_lateness, lateness);
+    }
+
+    // Prints statistics, starting every line with 'prefix'.
+    void print_statistics(std::ostream &out, const std::string &prefix) const {
+        out << prefix << "Turn lateness: " << turns << " turns, mean "
+            << (turns > 0 ? to_us(total_lateness) / turns : 0) << " us, max "
+            << to_us(max_lateness) << " us, turns took " << to_us(last_turn_start - start) / 1000
+            << " ms (" << to_us(turns * turn_duration) / 1000 << " ms planned)\n";
+        for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+            if (lateness_histogram[bucket] == 0) {
+                continue;
+            }
+            out << prefix << "Turn lateness ";
+            if (bucket == 0) {
+                out << "< 1 us";
+            } else if (bucket == BUCKETS - 1) {
+                out << ">= " << (1ULL << (bucket - 1)) << " us";
+            } else {
+                out << "[" << (1ULL << (bucket - 1)) << ", " << (1ULL << bucket) << ") us";
+            }
+            out << ": " << lateness_histogram[bucket] << " turns\n";
+        }
+    }
+};
+
+#endif //TURN_SCHEDULER_H